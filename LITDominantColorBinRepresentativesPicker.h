@@ -59,7 +59,8 @@ struct LITDominantColorRepresentativesPickerConfiguration {
 
 /// Detect clusters in the bin and returns a list of representative colors of the cluster.
 ///
-/// @param bin image bin to extract representatives from.
+/// @param bin distinct colors of the image bin to extract representatives from. The number of
+/// occurrences of each color is taken from \c histogram.
 ///
 /// @param hsBinIndex the bin index.
 ///
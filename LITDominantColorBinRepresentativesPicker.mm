@@ -3,6 +3,7 @@
 
 #import "LITDominantColorBinRepresentativesPicker.h"
 
+#import <map>
 #import <queue>
 
 #import "LITDominantColorUtilities.h"
@@ -26,6 +27,21 @@ struct LITDBScanPoint {
   }
 };
 
+/// Structure stores the part of the DBScan neighborhood stencil that lies on a single line along
+/// the V axis. The neighborhood of a point P contains the points
+/// P + (\c hueOffset, \c saturationOffset, v) for every v in [-\c valueRadius, \c valueRadius],
+/// excluding P itself.
+struct LITNeighborValueSpan {
+  /// Offset of the line in hue field.
+  int hueOffset;
+
+  /// Offset of the line in saturation field.
+  int saturationOffset;
+
+  /// Radius of the neighborhood along the line in value field.
+  int valueRadius;
+};
+
 /// Structure stores the colors that DBScan cluster contains. This structure used to extract the
 /// cluster representative.
 struct LITDBScanCluster {
@@ -45,10 +61,12 @@ struct LITDBScanCluster {
 
 @interface LITDominantColorBinRepresentativesPicker ()
 
-/// A list that contains all neighbors inside radius \c dbScanRadius of the origin point.
-/// For each point P, its neighbors will be P + relativeNeighbor for each relativeNeighbor
-/// in relativeNeighborList.
-@property (nonatomic, readonly) std::vector<cv::Point3i> relativeNeighborList;
+/// A list that decomposes the neighborhood of radius \c dbScanRadius around the origin point to
+/// spans along the V axis, one span per (H, S) line that the neighborhood intersects.
+@property (nonatomic, readonly) std::vector<LITNeighborValueSpan> neighborValueSpanList;
+
+/// Largest \c valueRadius in \c neighborValueSpanList.
+@property (nonatomic, readonly) int maxNeighborValueRadius;
 
 /// Bin width in hue filed field.
 @property (nonatomic, readonly) int binHueWidth;
@@ -77,7 +95,12 @@ struct LITDBScanCluster {
     _representativePercentileParams = representativePercentileParams;
     _configuration = representativePickerConfiguration;
 
-    _relativeNeighborList = [self calculateRelativeNeighbors];
+    _neighborValueSpanList =
+        [self neighborValueSpansWithRelativeNeighbors:[self calculateRelativeNeighbors]];
+    _maxNeighborValueRadius = 0;
+    for (auto &span : _neighborValueSpanList) {
+      _maxNeighborValueRadius = std::max(_maxNeighborValueRadius, span.valueRadius);
+    }
   }
   return self;
 };
@@ -91,8 +114,16 @@ struct LITDBScanCluster {
   /// if not found any cluster in the bin with DBScan, create one cluster from all bin,
   /// and return its representative as the bin dominant color.
   if (representatives.empty()) {
-    auto clusterRepresentative = representativeOfSlice(cv::Mat3b(bin), (int)bin.size(),
-                                                       self.representativePercentileParams);
+    std::vector<int> repetitions;
+    repetitions.reserve(bin.size());
+    int binSize = 0;
+    for (auto &color : bin) {
+      repetitions.push_back(histogram(color(0), color(1), color(2)));
+      binSize += repetitions.back();
+    }
+    auto clusterRepresentative = representativeOfSlice(cv::Mat3b(bin), binSize,
+                                                       self.representativePercentileParams,
+                                                       repetitions);
     representatives = {clusterRepresentative};
   }
   return representatives;
@@ -118,23 +149,22 @@ struct LITDBScanCluster {
   reusableCluster.clusterColors = cv::Mat3b(largestOptionalClusterSize, 1);
   reusableCluster.clusterColorRepetitions.resize(largestOptionalClusterSize);
 
+  /// Core points are determined for the whole bin in advance, so that expanding the clusters only
+  /// needs to look up whether a point is a core point.
+  auto corePointMap = [self corePointMapOfBinWithIndex:hsBinIndex histogram:globalHistogram];
+
   std::vector<std::pair<cv::Vec3b,int>> clusterRepresentativeColorAndSizeList;
   for (auto &colorValue : bin) {
     if ([self isVisited:colorValue dbPoints:dbScanPoints]) {
       continue;
     }
-    std::vector<cv::Vec3b> uniqueNeighborValues;
-    auto numberOfNeighbors = [self neighborsCountOfPoint:colorValue inBinIndex:hsBinIndex
-                                               histogram:globalHistogram
-                             populateUniqueNeighborValue:&uniqueNeighborValues];
-    if (numberOfNeighbors + 1 < self.configuration.dbScanMinNeighbors) {
+    if (![self isCorePoint:colorValue corePointMap:corePointMap]) {
       [self setAsNoise:colorValue dbPoints:&dbScanPoints];
       continue;
     }
     [self resetCluster:&reusableCluster];
-    [self processPoints:&dbScanPoints startingAtCorePoint:colorValue
-        withUniqueNeighborValues:uniqueNeighborValues populateCluster:&reusableCluster
-        histogram:globalHistogram inBinIndex:hsBinIndex];
+    [self processPoints:&dbScanPoints startingAtCorePoint:colorValue corePointMap:corePointMap
+        populateCluster:&reusableCluster histogram:globalHistogram inBinIndex:hsBinIndex];
     auto hsv = [self representativeOfCluster:reusableCluster];
     clusterRepresentativeColorAndSizeList.push_back({hsv, reusableCluster.totalClusterSize});
   }
@@ -143,68 +173,64 @@ struct LITDBScanCluster {
   return representatives;
  }
 
-- (unsigned int)neighborsCountOfPoint:(cv::Vec3b)point inBinIndex:(LITHSBinIndex)hsBinIndex
-                            histogram:(cv::Mat1f)histogram
-          populateUniqueNeighborValue:(std::vector<cv::Vec3b> *)uniqueNeighborValues {
-   unsigned int numberOfNeighbors = 0;
-   numberOfNeighbors += histogram(point(0), point(1), point(2)) - 1;
-
-    for (auto &relativeNeighbor : self.relativeNeighborList) {
-      auto neighbor = cv::Point3i(point) + relativeNeighbor;
-      if (neighbor.x >= hsBinIndex.hueIndex * self.binHueWidth &&
-          neighbor.x < (hsBinIndex.hueIndex + 1) * self.binHueWidth &&
-          neighbor.y >= hsBinIndex.saturationIndex * self.binSaturationWidth &&
-          neighbor.y < (hsBinIndex.saturationIndex + 1) * self.binSaturationWidth &&
-          neighbor.z >= 0 && neighbor.z < 256) {
-        auto neighborRepetitions = histogram(neighbor.x, neighbor.y, neighbor.z);
-        if (neighborRepetitions > 0) {
-          uniqueNeighborValues->push_back(cv::Vec3b(neighbor.x, neighbor.y, neighbor.z));
-          numberOfNeighbors += neighborRepetitions;
-        }
+- (void)populateNeighborsOfPoint:(const cv::Vec3b &)point inBinIndex:(LITHSBinIndex)hsBinIndex
+                       histogram:(const cv::Mat1f &)histogram
+                       neighbors:(std::vector<cv::Vec3b> *)neighbors {
+  auto hueStart = hsBinIndex.hueIndex * self.binHueWidth;
+  auto saturationStart = hsBinIndex.saturationIndex * self.binSaturationWidth;
+  for (auto &span : _neighborValueSpanList) {
+    auto hue = point(0) + span.hueOffset;
+    auto saturation = point(1) + span.saturationOffset;
+    if (hue < hueStart || hue >= hueStart + self.binHueWidth || saturation < saturationStart ||
+        saturation >= saturationStart + self.binSaturationWidth) {
+      continue;
+    }
+    auto histogramLine = histogram.ptr<float>(hue, saturation);
+    auto isOriginLine = span.hueOffset == 0 && span.saturationOffset == 0;
+    auto valueEnd = std::min(point(2) + span.valueRadius, 255);
+    for (int value = std::max(point(2) - span.valueRadius, 0); value <= valueEnd; value++) {
+      if (histogramLine[value] > 0 && !(isOriginLine && value == point(2))) {
+        neighbors->push_back(cv::Vec3b(hue, saturation, value));
       }
     }
-  return numberOfNeighbors;
+  }
 }
 
 - (void)processPoints:(std::vector<LITDBScanPoint> *)dbScanPoints
   startingAtCorePoint:(const cv::Vec3b &)startCorePoint
-withUniqueNeighborValues:(const std::vector<cv::Vec3b> &)uniqueNeighborValues
+         corePointMap:(const cv::Mat1b &)corePointMap
       populateCluster:(LITDBScanCluster *)reusableCluster histogram:(const cv::Mat1f &)histogram
            inBinIndex:(LITHSBinIndex)hsBinIndex {
   /// \c LITDBScanCluster uses the point value as a color, while \c LITDBScanPoint uses the point
   /// value as an abstract point, indicating the point position in the histogram.
+  /// Points are added to the cluster as soon as they are reached, and only core points are queued
+  /// to be expanded, so that each point is queued at most once.
   [self addPoint:startCorePoint toDBPoints:dbScanPoints];
   [self addColor:startCorePoint toCluster:reusableCluster repetitions:histogram(startCorePoint(0),
                                                                                 startCorePoint(1),
                                                                                 startCorePoint(2))];
-  std::queue<cv::Vec3b> clusterSet;
-  for (auto &neighbor : uniqueNeighborValues) {
-    clusterSet.push(neighbor);
-  }
-  while (!clusterSet.empty()) {
-    auto point = clusterSet.front();
-    clusterSet.pop();
-    if ([self isVisited:point dbPoints:*dbScanPoints]) {
-      if ([self isNoise:point dbPoints:*dbScanPoints]) {
-         [self addPoint:point toDBPoints:dbScanPoints];
-         [self addColor:point toCluster:reusableCluster repetitions:histogram(point(0),point(1),
-                                                                                       point(2))];
+  std::queue<cv::Vec3b> corePoints;
+  corePoints.push(startCorePoint);
+  std::vector<cv::Vec3b> neighbors;
+  while (!corePoints.empty()) {
+    auto point = corePoints.front();
+    corePoints.pop();
+
+    neighbors.clear();
+    [self populateNeighborsOfPoint:point inBinIndex:hsBinIndex histogram:histogram
+                         neighbors:&neighbors];
+    for (auto &neighbor : neighbors) {
+      if ([self isVisited:neighbor dbPoints:*dbScanPoints] &&
+          ![self isNoise:neighbor dbPoints:*dbScanPoints]) {
+        continue;
+      }
+      [self addPoint:neighbor toDBPoints:dbScanPoints];
+      [self addColor:neighbor toCluster:reusableCluster repetitions:histogram(neighbor(0),
+                                                                              neighbor(1),
+                                                                              neighbor(2))];
+      if ([self isCorePoint:neighbor corePointMap:corePointMap]) {
+        corePoints.push(neighbor);
       }
-      continue;
-    }
-
-   [self addPoint:point toDBPoints:dbScanPoints];
-   [self addColor:point toCluster:reusableCluster repetitions:histogram(point(0),point(1),
-                                                                        point(2))];
-   std::vector<cv::Vec3b> uniqueNeighborValues;
-   auto numberOfNeighbors = [self neighborsCountOfPoint:point inBinIndex:hsBinIndex
-                                              histogram:histogram
-                            populateUniqueNeighborValue:&uniqueNeighborValues];
-    if (numberOfNeighbors + 1 < self.configuration.dbScanMinNeighbors) {
-      continue;
-    }
-    for (auto &neighbor : uniqueNeighborValues) {
-      clusterSet.push(neighbor);
     }
   }
 }
@@ -224,6 +250,81 @@ withUniqueNeighborValues:(const std::vector<cv::Vec3b> &)uniqueNeighborValues
   return sortedRepresentatives;
 }
 
+#pragma mark -
+#pragma mark Core Point Map
+#pragma mark -
+
+- (cv::Mat1b)corePointMapOfBinWithIndex:(LITHSBinIndex)hsBinIndex
+                              histogram:(const cv::Mat1f &)histogram {
+  auto maxValueRadius = self.maxNeighborValueRadius;
+  auto hueStart = hsBinIndex.hueIndex * self.binHueWidth;
+  auto saturationStart = hsBinIndex.saturationIndex * self.binSaturationWidth;
+  auto numberOfLines = self.binHueWidth * self.binSaturationWidth;
+
+  /// Each row of \c prefixSums holds the prefix sums of a single (H, S) line of the bin along the V
+  /// axis, padded by \c maxValueRadius zeros before the line and by the line total after it. So
+  /// that for every v and r <= \c maxValueRadius, the number of points in [v - r, v + r] is
+  /// <tt>prefixSums(line, v + R + r + 1) - prefixSums(line, v + R - r)</tt>, where R is
+  /// \c maxValueRadius.
+  cv::Mat1f prefixSums = cv::Mat1f::zeros(numberOfLines, 256 + 2 * maxValueRadius + 1);
+  std::vector<bool> isEmptyLine(numberOfLines);
+  for (int i = 0; i < self.binHueWidth; i++) {
+    for (int j = 0; j < self.binSaturationWidth; j++) {
+      auto histogramLine = histogram.ptr<float>(hueStart + i, saturationStart + j);
+      auto prefixSumsLine = prefixSums[i * self.binSaturationWidth + j];
+      for (int value = 0; value < 256; value++) {
+        prefixSumsLine[maxValueRadius + value + 1] = prefixSumsLine[maxValueRadius + value] +
+            histogramLine[value];
+      }
+      auto lineTotal = prefixSumsLine[maxValueRadius + 256];
+      for (int k = maxValueRadius + 257; k < prefixSums.cols; k++) {
+        prefixSumsLine[k] = lineTotal;
+      }
+      isEmptyLine[i * self.binSaturationWidth + j] = lineTotal == 0;
+    }
+  }
+
+  /// Number of points in the neighborhood of each point of the bin, including the point itself.
+  /// Every neighborhood span is evaluated for a whole line at once as a difference of two shifted
+  /// rows of \c prefixSums.
+  cv::Mat1f neighborCounts = cv::Mat1f::zeros(numberOfLines, 256);
+  for (int i = 0; i < self.binHueWidth; i++) {
+    for (int j = 0; j < self.binSaturationWidth; j++) {
+      if (isEmptyLine[i * self.binSaturationWidth + j]) {
+        continue;
+      }
+      auto neighborCountsLine = neighborCounts.row(i * self.binSaturationWidth + j);
+      for (auto &span : _neighborValueSpanList) {
+        auto neighborHue = i + span.hueOffset;
+        auto neighborSaturation = j + span.saturationOffset;
+        if (neighborHue < 0 || neighborHue >= self.binHueWidth || neighborSaturation < 0 ||
+            neighborSaturation >= self.binSaturationWidth) {
+          continue;
+        }
+        auto neighborLine = neighborHue * self.binSaturationWidth + neighborSaturation;
+        if (isEmptyLine[neighborLine]) {
+          continue;
+        }
+        auto prefixSumsLine = prefixSums.row(neighborLine);
+        auto rangeEnd = maxValueRadius + span.valueRadius + 1;
+        auto rangeStart = maxValueRadius - span.valueRadius;
+        cv::add(neighborCountsLine, prefixSumsLine.colRange(rangeEnd, rangeEnd + 256),
+                neighborCountsLine);
+        cv::subtract(neighborCountsLine, prefixSumsLine.colRange(rangeStart, rangeStart + 256),
+                     neighborCountsLine);
+      }
+    }
+  }
+
+  cv::Mat1b corePointMap = neighborCounts >= self.configuration.dbScanMinNeighbors;
+  return corePointMap;
+}
+
+- (bool)isCorePoint:(const cv::Vec3b &)point corePointMap:(const cv::Mat1b &)corePointMap {
+  auto relativeOffset = [self offsetOfPointInDBScanPointList:point];
+  return corePointMap.data[relativeOffset];
+}
+
 #pragma mark -
 #pragma mark LITDBScanPoint
 #pragma mark -
@@ -286,6 +387,23 @@ withUniqueNeighborValues:(const std::vector<cv::Vec3b> &)uniqueNeighborValues
 #pragma mark Neighbor Index Initialization
 #pragma mark -
 
+- (std::vector<LITNeighborValueSpan>)neighborValueSpansWithRelativeNeighbors:
+    (const std::vector<cv::Point3i> &)relativeNeighbors {
+  /// The origin line is always part of the neighborhood, even if the neighborhood radius is too
+  /// small to contain any other point on it.
+  std::map<std::pair<int, int>, int> valueRadiusPerLine = {{{0, 0}, 0}};
+  for (auto &relativeNeighbor : relativeNeighbors) {
+    auto &valueRadius = valueRadiusPerLine[{relativeNeighbor.x, relativeNeighbor.y}];
+    valueRadius = std::max(valueRadius, std::abs(relativeNeighbor.z));
+  }
+
+  std::vector<LITNeighborValueSpan> spans;
+  for (auto &[line, valueRadius] : valueRadiusPerLine) {
+    spans.push_back({line.first, line.second, valueRadius});
+  }
+  return spans;
+}
+
 - (std::vector<cv::Point3i>)calculateRelativeNeighbors {
   std::vector<cv::Point3i> relativeNeighbors;
   auto firstOctantNeighbors = [self calculateRelativeNeighborsForFirstOctant];
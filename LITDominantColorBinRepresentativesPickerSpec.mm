@@ -0,0 +1,236 @@
+// Copyright (c) 2020 Lightricks. All rights reserved.
+// Created by Roni Shahino.
+
+#import "LITDominantColorBinRepresentativesPicker.h"
+
+#import <queue>
+#import <unordered_map>
+
+#import "LITDominantColorUtilities.h"
+
+@interface LITDominantColorBinRepresentativesPicker (DBScan)
+- (cv::Mat1b)corePointMapOfBinWithIndex:(LITHSBinIndex)hsBinIndex
+                              histogram:(const cv::Mat1f &)histogram;
+- (std::vector<cv::Point3i>)calculateRelativeNeighbors;
+@end
+
+static const int kBinHueWidth = 36;
+static const int kBinSaturationWidth = 32;
+
+static bool LITIsPointInBin(const cv::Point3i &point, LITHSBinIndex hsBinIndex) {
+  return point.x >= hsBinIndex.hueIndex * kBinHueWidth &&
+      point.x < (hsBinIndex.hueIndex + 1) * kBinHueWidth &&
+      point.y >= hsBinIndex.saturationIndex * kBinSaturationWidth &&
+      point.y < (hsBinIndex.saturationIndex + 1) * kBinSaturationWidth &&
+      point.z >= 0 && point.z < 256;
+}
+
+static int LITKeyOfPoint(const cv::Vec3b &point) {
+  return (point(0) << 16) | (point(1) << 8) | point(2);
+}
+
+/// Number of points within the neighborhood of \c point in its bin, including the occurrences of
+/// \c point itself. Non empty neighbors are appended to \c neighbors if it is not null.
+static float LITNeighborhoodSize(const cv::Vec3b &point, LITHSBinIndex hsBinIndex,
+                                 const cv::Mat1f &histogram,
+                                 const std::vector<cv::Point3i> &relativeNeighbors,
+                                 std::vector<cv::Vec3b> * _Nullable neighbors) {
+  float neighborhoodSize = histogram(point(0), point(1), point(2));
+  for (auto &relativeNeighbor : relativeNeighbors) {
+    auto neighbor = cv::Point3i(point(0), point(1), point(2)) + relativeNeighbor;
+    if (!LITIsPointInBin(neighbor, hsBinIndex)) {
+      continue;
+    }
+    auto repetitions = histogram(neighbor.x, neighbor.y, neighbor.z);
+    if (repetitions > 0) {
+      neighborhoodSize += repetitions;
+      if (neighbors) {
+        neighbors->push_back(cv::Vec3b(neighbor.x, neighbor.y, neighbor.z));
+      }
+    }
+  }
+  return neighborhoodSize;
+}
+
+/// DBScan that counts the neighborhood of every visited point and expands the clusters by visiting
+/// all the neighbors of their core points.
+static std::vector<cv::Vec3b> LITVisitBasedRepresentatives(const std::vector<cv::Vec3b> &bin,
+    LITHSBinIndex hsBinIndex, const cv::Mat1f &histogram,
+    const std::vector<cv::Point3i> &relativeNeighbors, unsigned int minNeighbors,
+    LITDominantColorRepresentativePercentileParams representativePercentileParams) {
+  /// Keys of visited points, mapped to whether the point is noise.
+  std::unordered_map<int, bool> isNoise;
+  std::vector<std::pair<cv::Vec3b, int>> representativesAndSizes;
+  for (auto &colorValue : bin) {
+    if (isNoise.count(LITKeyOfPoint(colorValue))) {
+      continue;
+    }
+    std::vector<cv::Vec3b> neighbors;
+    if (LITNeighborhoodSize(colorValue, hsBinIndex, histogram, relativeNeighbors, &neighbors) <
+        minNeighbors) {
+      isNoise[LITKeyOfPoint(colorValue)] = true;
+      continue;
+    }
+
+    std::vector<cv::Vec3b> clusterColors;
+    std::vector<int> clusterRepetitions;
+    int clusterSize = 0;
+    auto addToCluster = [&](const cv::Vec3b &point) {
+      isNoise[LITKeyOfPoint(point)] = false;
+      clusterColors.push_back(point);
+      clusterRepetitions.push_back(histogram(point(0), point(1), point(2)));
+      clusterSize += clusterRepetitions.back();
+    };
+
+    addToCluster(colorValue);
+    std::queue<cv::Vec3b> clusterSet;
+    for (auto &neighbor : neighbors) {
+      clusterSet.push(neighbor);
+    }
+    while (!clusterSet.empty()) {
+      auto point = clusterSet.front();
+      clusterSet.pop();
+      auto visitedPoint = isNoise.find(LITKeyOfPoint(point));
+      if (visitedPoint != isNoise.end()) {
+        if (visitedPoint->second) {
+          addToCluster(point);
+        }
+        continue;
+      }
+
+      addToCluster(point);
+      std::vector<cv::Vec3b> pointNeighbors;
+      if (LITNeighborhoodSize(point, hsBinIndex, histogram, relativeNeighbors, &pointNeighbors) <
+          minNeighbors) {
+        continue;
+      }
+      for (auto &neighbor : pointNeighbors) {
+        clusterSet.push(neighbor);
+      }
+    }
+
+    auto representative = lit_dominant_color::representativeOfSlice(cv::Mat3b(clusterColors),
+        clusterSize, representativePercentileParams, clusterRepetitions);
+    representativesAndSizes.push_back({representative, clusterSize});
+  }
+
+  std::sort(representativesAndSizes.begin(), representativesAndSizes.end(),
+            [](const std::pair<cv::Vec3b, int> &a, const std::pair<cv::Vec3b, int> &b) {
+    return a.second > b.second;
+  });
+  std::vector<cv::Vec3b> representatives;
+  for (auto &[representative, size] : representativesAndSizes) {
+    representatives.push_back(representative);
+  }
+  return representatives;
+}
+
+SpecBegin(LITDominantColorBinRepresentativesPicker)
+
+const LITDominantColorRepresentativesPickerConfiguration kConfiguration = {
+  .dbScanRadius = 0.0049,
+  .dbScanMinNeighbors = 30,
+  .dbScanPointMultipliers = {1.1, 0.5, 0.5}
+};
+const auto kPercentileParams = LITDominantColorRepresentativePercentileParamsMake(0.5, 0.85, 0.85);
+const LITHSBinIndex kBinIndex(1, 2);
+
+__block LITDominantColorBinRepresentativesPicker *picker;
+__block cv::Mat1f histogram;
+__block std::vector<cv::Vec3b> bin;
+
+beforeEach(^{
+  picker = [[LITDominantColorBinRepresentativesPicker alloc]
+            initWithBinHueWidth:kBinHueWidth binSaturationWidth:kBinSaturationWidth
+            representativePercentileParams:kPercentileParams
+            representativePickerConfiguration:kConfiguration];
+
+  int histogramSize[3] = {180, 256, 256};
+  histogram = cv::Mat1f::zeros(3, histogramSize);
+  cv::RNG rng(0);
+
+  // Dense cluster in the bin interior.
+  for (int h = 48; h <= 52; h++) {
+    for (int s = 77; s <= 83; s++) {
+      for (int v = 124; v <= 132; v++) {
+        histogram(h, s, v) = rng.uniform(1, 6);
+      }
+    }
+  }
+
+  // Smaller cluster touching the bin corner at the lowest value.
+  histogram(36, 64, 0) = 40;
+  histogram(36, 64, 1) = 3;
+  histogram(37, 65, 2) = 2;
+
+  // Cells at the opposite bin corner at the highest value, which form a core point only together.
+  histogram(71, 95, 255) = 10;
+  histogram(71, 94, 254) = 10;
+  histogram(70, 95, 255) = 15;
+
+  // Dense cells just outside the bin, which must not be counted as neighbors.
+  histogram(35, 64, 0) = 100;
+  histogram(36, 63, 1) = 100;
+  histogram(72, 95, 255) = 100;
+  histogram(71, 96, 254) = 100;
+
+  // Sparse noise in the bin.
+  for (int i = 0; i < 300; i++) {
+    histogram(rng.uniform(36, 72), rng.uniform(64, 96), rng.uniform(0, 256)) += rng.uniform(1, 4);
+  }
+
+  bin.clear();
+  for (int h = 36; h < 72; h++) {
+    for (int s = 64; s < 96; s++) {
+      for (int v = 0; v < 256; v++) {
+        if (histogram(h, s, v) > 0) {
+          bin.push_back(cv::Vec3b(h, s, v));
+        }
+      }
+    }
+  }
+});
+
+it(@"should find core points as counting the neighbors of each point", ^{
+  auto corePointMap = [picker corePointMapOfBinWithIndex:kBinIndex histogram:histogram];
+  auto relativeNeighbors = [picker calculateRelativeNeighbors];
+
+  expect(corePointMap.rows).to.equal(kBinHueWidth * kBinSaturationWidth);
+  expect(corePointMap.cols).to.equal(256);
+
+  // The map is defined on lines of the bin that contain points.
+  int numberOfCorePoints = 0;
+  for (int i = 0; i < kBinHueWidth; i++) {
+    for (int j = 0; j < kBinSaturationWidth; j++) {
+      auto hue = kBinIndex.hueIndex * kBinHueWidth + i;
+      auto saturation = kBinIndex.saturationIndex * kBinSaturationWidth + j;
+      if (cv::countNonZero(cv::Mat1f(1, 256, histogram.ptr<float>(hue, saturation))) == 0) {
+        continue;
+      }
+      for (int v = 0; v < 256; v++) {
+        auto neighborhoodSize = LITNeighborhoodSize(cv::Vec3b(hue, saturation, v), kBinIndex,
+                                                    histogram, relativeNeighbors, nullptr);
+        bool isCorePoint = neighborhoodSize >= kConfiguration.dbScanMinNeighbors;
+        expect(corePointMap(i * kBinSaturationWidth + j, v) != 0).to.equal(isCorePoint);
+        numberOfCorePoints += isCorePoint;
+      }
+    }
+  }
+  expect(numberOfCorePoints).to.beGreaterThan(0);
+});
+
+it(@"should find the same representatives as visiting the neighbors of each point", ^{
+  auto representatives = [picker findRepresentativeColorsInBin:bin withIndex:kBinIndex
+                                                     histogram:histogram];
+  auto expectedRepresentatives =
+      LITVisitBasedRepresentatives(bin, kBinIndex, histogram, [picker calculateRelativeNeighbors],
+                                   kConfiguration.dbScanMinNeighbors, kPercentileParams);
+
+  expect(expectedRepresentatives.size()).to.beGreaterThan(1);
+  expect(representatives.size()).to.equal(expectedRepresentatives.size());
+  for (size_t i = 0; i < std::min(representatives.size(), expectedRepresentatives.size()); i++) {
+    expect(representatives[i] == expectedRepresentatives[i]).to.beTruthy();
+  }
+});
+
+SpecEnd
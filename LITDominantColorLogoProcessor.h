@@ -74,7 +74,8 @@ LT_C_DECLS_END
 /// Algorithm steps:
 ///
 /// 1. Image preprocessing -> reduce resolution + remove alpha channel + convert to HSV color space.
-/// 2. Detect foreground pixels in the image (the logo itself without the background).
+/// 2. Detect foreground pixels in the image (the logo itself without the background), unless a mask
+///    defining them is given.
 /// 2. Divide the color range of H, S, V channels, and the gray range into bins.
 /// 3. For each bin:
 ///    3.1. Declare a mask indicates the bin pixels, and perform erosion of this mask.
@@ -104,6 +105,22 @@ LT_C_DECLS_END
 - (NSArray<LITDominantColor*> *)dominantColorsInImage:(id<MTLTexture>)texture
                                  maxWorkingResolution:(int)maxWorkingResolution;
 
+/// Finds dominant colors in the region of logo image defined by \c mask.
+///
+/// @param texture input image.
+///
+/// @param mask mask defining the foreground pixels of \c texture, such as a segmentation mask or an
+/// alpha matte. Pixels with mask value of at least half of the value range are considered
+/// foreground. Must have 1 channel of type uchar and the same size as \c texture. If \c nil, the
+/// background is detected from the image and removed from the returned dominant colors list.
+///
+/// @param maxWorkingResolution maximum resolution of image to process. Larger images are resized so
+/// that their largest dimension equals this value.
+/// @note This parameter has a direct effect on the runtime of this operation.
+- (NSArray<LITDominantColor*> *)dominantColorsInImage:(id<MTLTexture>)texture
+                                                 mask:(nullable id<MTLTexture>)mask
+                                 maxWorkingResolution:(int)maxWorkingResolution;
+
 @end
 
 NS_ASSUME_NONNULL_END
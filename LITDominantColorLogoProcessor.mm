@@ -83,8 +83,18 @@ struct LITBackgroundParams {
 
 - (NSArray<LITDominantColor*> *)dominantColorsInImage:(id<MTLTexture>)texture
                                  maxWorkingResolution:(int)maxWorkingResolution {
+  return [self dominantColorsInImage:texture mask:nil maxWorkingResolution:maxWorkingResolution];
+}
+
+- (NSArray<LITDominantColor*> *)dominantColorsInImage:(id<MTLTexture>)texture
+                                                 mask:(nullable id<MTLTexture>)mask
+                                 maxWorkingResolution:(int)maxWorkingResolution {
   auto kValidPixelFormat = {MTLPixelFormatRGBA8Unorm, MTLPixelFormatBGRA8Unorm};
   [LITImageValidator validateTexture:texture forPixelFormats:kValidPixelFormat];
+  if (mask) {
+    [[LITImageValidator validateTexture:nn(mask) forPixelFormats:{MTLPixelFormatR8Unorm}]
+        validateTexture:nn(mask) forSameSizeAsTexture:texture];
+  }
 
   __block cv::Mat3b preprocessedImage;
   [mtb(texture) mtb_mappedForReading:^(const cv::Mat &image) {
@@ -94,19 +104,34 @@ struct LITBackgroundParams {
 
   auto hsv = [self hsvImage:preprocessedImage withPixelFormat:texture.pixelFormat];
 
-  auto backgroundParams = [self backgroundParamsFromImage:preprocessedImage];
-  if (backgroundParams.numberOfForegroundPixels == 0) {
-    return [NSArray array];
-  }
-
   std::vector<ScoredColor> dominantColors;
-  [self extractDominantColorFromHSVImage:hsv
-                     numForegroundPixels:backgroundParams.numberOfForegroundPixels
-                  populateDominantColors:&dominantColors];
+  if (mask) {
+    // The mask defines the foreground, so background detection is skipped and only pixels inside
+    // the mask spans are visited.
+    auto spans = pixelSpansFromMaskTexture(nn(mask), hsv.size());
+    auto numberOfForegroundPixels = numberOfPixelsInSpans(spans);
+    if (numberOfForegroundPixels == 0) {
+      return [NSArray array];
+    }
+
+    [self extractDominantColorFromHSVImage:hsv spans:spans
+                       numForegroundPixels:numberOfForegroundPixels
+                    populateDominantColors:&dominantColors];
+    [self convertDominantColorFromHSVToLUV:&dominantColors];
+  } else {
+    auto backgroundParams = [self backgroundParamsFromImage:preprocessedImage];
+    if (backgroundParams.numberOfForegroundPixels == 0) {
+      return [NSArray array];
+    }
+
+    [self extractDominantColorFromHSVImage:hsv spans:pixelSpansOfSize(hsv.size())
+                       numForegroundPixels:backgroundParams.numberOfForegroundPixels
+                    populateDominantColors:&dominantColors];
+    [self convertDominantColorFromHSVToLUV:&dominantColors];
+    [self removeBackgroundColorFromLUVDominantColors:&dominantColors
+                                withBackgroundParams:backgroundParams];
+  }
 
-  [self convertDominantColorFromHSVToLUV:&dominantColors];
-  [self removeBackgroundColorFromLUVDominantColors:&dominantColors
-                              withBackgroundParams:backgroundParams];
   [self sortDominantColorsByScore:&dominantColors];
   auto filteredDominantColors = filterDominantColors(dominantColors,
                                                      self.configuration.initialMinLUVDistance,
@@ -311,10 +336,11 @@ struct LITBackgroundParams {
 #pragma mark -
 
 - (void)extractDominantColorFromHSVImage:(const cv::Mat3b &)hsvImage
+                                   spans:(const std::vector<PixelSpan> &)spans
                      numForegroundPixels:(int)numForegroundPixels
                   populateDominantColors:(std::vector<ScoredColor> *)dominantColors {
   std::vector<std::vector<cv::Vec3b>> slices;
-  [self splitPixelsToBinsWithImage:hsvImage populateSlicePerBin:&slices];
+  [self splitPixelsToBinsWithImage:hsvImage spans:spans populateSlicePerBin:&slices];
 
   for (auto &slice : slices) {
     float sliceScore = (float)slice.size() / numForegroundPixels;
@@ -328,8 +354,9 @@ struct LITBackgroundParams {
 }
 
 - (void)splitPixelsToBinsWithImage:(const cv::Mat3b &)hsvImage
+                             spans:(const std::vector<PixelSpan> &)spans
                populateSlicePerBin:(std::vector<std::vector<cv::Vec3b>> *)slicePerBin {
-  auto binIndexImage = [self binIndexImageWithHSVImage:hsvImage];
+  auto binIndexImage = [self binIndexImageWithHSVImage:hsvImage spans:spans];
 
   cv::Mat1s erodedBinIndexImage, dilatedBinIndexImage;
   static const int kErosionKernelSize = 3;
@@ -341,38 +368,49 @@ struct LITBackgroundParams {
   auto numBins = self.configuration.numOfGrayBins + self.configuration.numOfBinsInHField *
       self.configuration.numOfBinsInSField * self.configuration.numOfBinsInVField;
   slicePerBin->resize(numBins);
-  for (int i = 0; i < hsvImage.rows ; i++) {
-    for (int j = 0; j < hsvImage.cols ; j++) {
-      auto areaMinIndex = erodedBinIndexImage(i, j);
-      auto areaMaxIndex = dilatedBinIndexImage(i, j);
+  for (auto &span : spans) {
+    for (int j = span.startColumn; j < span.endColumn; j++) {
+      auto areaMinIndex = erodedBinIndexImage(span.row, j);
+      auto areaMaxIndex = dilatedBinIndexImage(span.row, j);
       if (areaMinIndex == areaMaxIndex) {
-        (*slicePerBin)[areaMinIndex].push_back(hsvImage(i, j));
+        (*slicePerBin)[areaMinIndex].push_back(hsvImage(span.row, j));
       }
     }
   }
 }
 
-- (cv::Mat1s)binIndexImageWithHSVImage:(const cv::Mat3b &)hsvImage {
+- (cv::Mat1s)binIndexImageWithHSVImage:(const cv::Mat3b &)hsvImage
+                                 spans:(const std::vector<PixelSpan> &)spans {
   int grayValueBinWidth =  std::ceil(256.0 / self.configuration.numOfGrayBins);
   int hueBinWidth = std::ceil(180.0 / self.configuration.numOfBinsInHField);
   int saturationBinWidth = std::ceil(256.0 / self.configuration.numOfBinsInSField);
   int valueBinWidth = std::ceil(256.0 / self.configuration.numOfBinsInVField);
 
+  /// Pixels outside \c spans get an index that doesn't belong to any bin, so that erosion discards
+  /// bin pixels bordering them.
+  static const short kOutsideSpansIndex = -1;
   static const int kMaxGraySaturation = 25;
-  cv::Mat1f binIndexImage(hsvImage.rows, hsvImage.cols);
-  hsvImage.forEach([&](cv::Vec3b &pixel, const int position[]) {
-    if (pixel(1) <= kMaxGraySaturation) {
-      auto grayValueIndex = pixel(2) / grayValueBinWidth;
-      binIndexImage(position[0], position[1]) = grayValueIndex;
-    } else {
-      auto hueIndex = pixel(0) / hueBinWidth;
-      auto saturationIndex = pixel(1) / saturationBinWidth;
-      auto valueIndex = pixel(2) / valueBinWidth;
-      auto totalIndex = (hueIndex * (self.configuration.numOfBinsInSField *
-                                     self.configuration.numOfBinsInVField) +
-                         saturationIndex * (self.configuration.numOfBinsInVField) + valueIndex);
-      totalIndex += self.configuration.numOfGrayBins;
-      binIndexImage(position[0], position[1]) = totalIndex;
+  cv::Mat1s binIndexImage(hsvImage.rows, hsvImage.cols, kOutsideSpansIndex);
+  cv::parallel_for_(cv::Range(0, (int)spans.size()), [&](const cv::Range &range) {
+    for (int spanIndex = range.start; spanIndex < range.end; spanIndex++) {
+      auto &span = spans[spanIndex];
+      for (int j = span.startColumn; j < span.endColumn; j++) {
+        auto &pixel = hsvImage(span.row, j);
+        if (pixel(1) <= kMaxGraySaturation) {
+          auto grayValueIndex = pixel(2) / grayValueBinWidth;
+          binIndexImage(span.row, j) = grayValueIndex;
+        } else {
+          auto hueIndex = pixel(0) / hueBinWidth;
+          auto saturationIndex = pixel(1) / saturationBinWidth;
+          auto valueIndex = pixel(2) / valueBinWidth;
+          auto totalIndex = (hueIndex * (self.configuration.numOfBinsInSField *
+                                         self.configuration.numOfBinsInVField) +
+                             saturationIndex * (self.configuration.numOfBinsInVField) +
+                             valueIndex);
+          totalIndex += self.configuration.numOfGrayBins;
+          binIndexImage(span.row, j) = totalIndex;
+        }
+      }
     }
   });
 
@@ -66,4 +66,36 @@ it(@"should return an empty dominant color list on a constant color image", ^{
   expect(dominantColors.count).to.equal(0);
 });
 
+it(@"should find dominant colors only inside the mask", ^{
+  cv::Mat4b image(64, 64, cv::Scalar(255, 0, 0, 255));
+  image.colRange(32, 64).setTo(cv::Scalar(0, 0, 255, 255));
+  auto input = [mtb(device) mtb_newIOSurfaceBackedTextureWithWidth:image.cols
+                                                            height:image.rows
+                                                       pixelFormat:MTLPixelFormatRGBA8Unorm];
+  [input mtb_mappedForWriting:^(cv::Mat *mat) {
+    image.copyTo(*mat);
+  }];
+
+  cv::Mat1b maskMat(image.rows, image.cols, (uchar)0);
+  maskMat.colRange(0, 32).setTo(255);
+  auto mask = [mtb(device) mtb_newIOSurfaceBackedTextureWithWidth:maskMat.cols
+                                                           height:maskMat.rows
+                                                      pixelFormat:MTLPixelFormatR8Unorm];
+  [mask mtb_mappedForWriting:^(cv::Mat *mat) {
+    maskMat.copyTo(*mat);
+  }];
+
+  const int kMaxWorkingResolution = 256;
+  auto dominantColors = [processor dominantColorsInImage:input mask:mask
+                                    maxWorkingResolution:kMaxWorkingResolution];
+
+  expect(dominantColors.count).to.equal(1);
+  CGFloat red, green, blue;
+  [dominantColors.firstObject.color getRed:&red green:&green blue:&blue alpha:nil];
+  expect(red).to.beCloseToWithin(1, 6 / 255.0);
+  expect(green).to.beCloseToWithin(0, 6 / 255.0);
+  expect(blue).to.beCloseToWithin(0, 6 / 255.0);
+  expect(dominantColors.firstObject.score).to.beCloseToWithin(1, 0.05);
+});
+
 SpecEnd
@@ -3,6 +3,8 @@
 
 #import "LITDominantColorRepresentativePercentileParams.h"
 
+#import <unordered_map>
+
 NS_ASSUME_NONNULL_BEGIN
 
 namespace lit_dominant_color {
@@ -24,6 +26,64 @@ struct ScoredColor {
   }
 };
 
+/// Structure stores a run of consecutive pixels in a single image row.
+struct PixelSpan {
+  /// Row of the span.
+  int row;
+
+  /// First column of the span.
+  int startColumn;
+
+  /// Column following the last column of the span.
+  int endColumn;
+};
+
+/// Compresses \c mask into run-length spans of consecutive pixels with value greater than or equal
+/// to \c threshold. The spans are ordered by row, and by column within each row.
+std::vector<PixelSpan> pixelSpansFromMask(const cv::Mat1b &mask, uchar threshold);
+
+/// Returns spans covering all the pixels of an image of size \c size, one span per row.
+std::vector<PixelSpan> pixelSpansOfSize(cv::Size size);
+
+/// Resizes \c mask to \c size and compresses it into run-length spans of its foreground pixels,
+/// namely pixels with mask value of at least half of the value range.
+/// \c mask must have 1 channel of type uchar.
+std::vector<PixelSpan> pixelSpansFromMaskTexture(id<MTLTexture> mask, cv::Size size);
+
+/// Returns the total number of pixels covered by \c spans.
+int numberOfPixelsInSpans(const std::vector<PixelSpan> &spans);
+
+/// Structure stores a single HSV value of a histogram and its number of occurrences.
+struct HSVHistogramEntry {
+  /// HSV value.
+  cv::Vec3b hsv;
+
+  /// Number of occurrences of \c hsv.
+  int count;
+};
+
+/// Histogram of HSV pixel values that can be accumulated separately over image tiles and merged.
+/// Merging is associative and commutative, so tiles can be accumulated in parallel and merged in
+/// any order.
+class HSVHistogramAccumulator {
+public:
+  /// Adds a single occurrence of \c hsvPixel to the histogram.
+  void addPixel(const cv::Vec3b &hsvPixel);
+
+  /// Adds all the pixel occurrences of \c other to the histogram.
+  void merge(const HSVHistogramAccumulator &other);
+
+  /// Returns the accumulated pixel values with their number of occurrences, ordered by value.
+  std::vector<HSVHistogramEntry> entries() const;
+
+private:
+  /// Returns the key of \c hsvPixel in \c counts.
+  static uint32_t keyOfPixel(const cv::Vec3b &hsvPixel);
+
+  /// Number of occurrences of each pixel value, keyed by \c keyOfPixel.
+  std::unordered_map<uint32_t, int> counts;
+};
+
 /// Filter \c scoredLUVDominantColorList by removing colors that are close in LUV color space to
 /// another color that already exists in the list.
 /// The luv distance threshold starts from \c initialMinLUVDistance, and increased in each element
@@ -3,6 +3,8 @@
 
 #import "LITDominantColorUtilities.h"
 
+#import <MetalToolbox/MTBTexture.h>
+
 NS_ASSUME_NONNULL_BEGIN
 
 namespace lit_dominant_color {
@@ -10,6 +12,86 @@ namespace lit_dominant_color {
 static int percentileForMatrix(const cv::Mat1b &mat, float percentileValue, int totalSize,
                                const std::vector<int> &repetitions);
 
+std::vector<PixelSpan> pixelSpansFromMask(const cv::Mat1b &mask, uchar threshold) {
+  std::vector<PixelSpan> spans;
+  for (int i = 0; i < mask.rows; i++) {
+    auto maskRow = mask[i];
+    int j = 0;
+    while (j < mask.cols) {
+      if (maskRow[j] < threshold) {
+        j++;
+        continue;
+      }
+      int startColumn = j;
+      while (j < mask.cols && maskRow[j] >= threshold) {
+        j++;
+      }
+      spans.push_back({i, startColumn, j});
+    }
+  }
+  return spans;
+}
+
+std::vector<PixelSpan> pixelSpansOfSize(cv::Size size) {
+  std::vector<PixelSpan> spans;
+  if (!size.width) {
+    return spans;
+  }
+  spans.reserve(size.height);
+  for (int i = 0; i < size.height; i++) {
+    spans.push_back({i, 0, size.width});
+  }
+  return spans;
+}
+
+std::vector<PixelSpan> pixelSpansFromMaskTexture(id<MTLTexture> mask, cv::Size size) {
+  __block cv::Mat1b resizedMask;
+  [mtb(mask) mtb_mappedForReading:^(const cv::Mat &maskMat) {
+    if (maskMat.size() == size) {
+      maskMat.copyTo(resizedMask);
+    } else {
+      cv::resize(maskMat, resizedMask, size, 0, 0, cv::INTER_AREA);
+    }
+  }];
+
+  static const uchar kForegroundThreshold = 128;
+  return pixelSpansFromMask(resizedMask, kForegroundThreshold);
+}
+
+int numberOfPixelsInSpans(const std::vector<PixelSpan> &spans) {
+  int numberOfPixels = 0;
+  for (auto &span : spans) {
+    numberOfPixels += span.endColumn - span.startColumn;
+  }
+  return numberOfPixels;
+}
+
+void HSVHistogramAccumulator::addPixel(const cv::Vec3b &hsvPixel) {
+  counts[keyOfPixel(hsvPixel)] += 1;
+}
+
+void HSVHistogramAccumulator::merge(const HSVHistogramAccumulator &other) {
+  for (auto &[key, count] : other.counts) {
+    counts[key] += count;
+  }
+}
+
+std::vector<HSVHistogramEntry> HSVHistogramAccumulator::entries() const {
+  std::vector<std::pair<uint32_t, int>> sortedCounts(counts.begin(), counts.end());
+  std::sort(sortedCounts.begin(), sortedCounts.end());
+
+  std::vector<HSVHistogramEntry> entries;
+  entries.reserve(sortedCounts.size());
+  for (auto &[key, count] : sortedCounts) {
+    entries.push_back({cv::Vec3b((key >> 16) & 0xFF, (key >> 8) & 0xFF, key & 0xFF), count});
+  }
+  return entries;
+}
+
+uint32_t HSVHistogramAccumulator::keyOfPixel(const cv::Vec3b &hsvPixel) {
+  return ((uint32_t)hsvPixel(0) << 16) | ((uint32_t)hsvPixel(1) << 8) | hsvPixel(2);
+}
+
 std::vector<ScoredColor> filterDominantColors(
     const std::vector<ScoredColor> &scoredLUVDominantColorList, float initialMinLUVDistance,
     float minLUVDistanceIncreaseRate) {
@@ -63,7 +145,7 @@ static int percentileForMatrix(const cv::Mat1b &mat,  float percentileValue, int
 
   cv::Mat1f cdf = cv::Mat1f::zeros(256, 1);
 
-  for (int i = 0; i < totalSize; i++) {
+  for (int i = 0; i < mat.rows; i++) {
     if (!repetitions.empty()) {
       cdf(mat(i,0)) += repetitions[i];
     } else {
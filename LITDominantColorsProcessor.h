@@ -119,6 +119,64 @@ LITDominantColorsConfiguration LITDominantColorsConfigurationDefault(void);
     maxWorkingResolution:(unsigned int)maxWorkingResolution
     bilateralFilterRangeSigma:(float)bilateralFilterRangeSigma
     commandQueue:(id<MTLCommandQueue>)commandQueue error:(NSError **)error;
+
+/// Finds dominant colors in the region of image defined by \c mask.
+///
+/// @param texture input image. Must have 4 channels of type uchar.
+///
+/// @param mask mask defining the region of \c texture to find dominant colors in, such as a
+/// segmentation mask or an alpha matte. Pixels with mask value of at least half of the value range
+/// are considered. Must have 1 channel of type uchar and the same size as \c texture. If \c nil,
+/// the whole image is considered.
+///
+/// @param maxWorkingResolution maximum resolution of image to process. Larger images are resized so
+/// that their largest dimension equals this value.
+///
+/// @param bilateralFilterRangeSigma range sigma passed to \c LITBilateralFilterProcessor in
+/// preprocessing step.
+///
+/// @param commandQueue command queue on which to perform the preprocessing calculation.
+///
+/// @param error output error if an error occurs.
+///
+/// @note Scores of the returned dominant colors are relative to the number of masked pixels.
+- (nullable NSArray<LITDominantColor*> *)findDominantColorsInImage:(id<MTLTexture>)texture
+    mask:(nullable id<MTLTexture>)mask maxWorkingResolution:(unsigned int)maxWorkingResolution
+    bilateralFilterRangeSigma:(float)bilateralFilterRangeSigma
+    commandQueue:(id<MTLCommandQueue>)commandQueue error:(NSError **)error;
+
+/// Finds dominant colors in image by streaming it tile by tile, without preprocessing the whole
+/// image at once. Each tile is preprocessed separately and its pixels are merged into a histogram,
+/// such that the preprocessing memory is bounded by \c maxTileSize rather than by the image size.
+/// Tiles are encoded one at a time, and read back and merged in parallel. Each tile is resized
+/// from the whole pixels of \c texture that cover it, so its pixel grid may be offset from the grid
+/// of the whole image by less than two pixels of \c texture. The dominant colors match those of
+/// \c findDominantColorsInImage:maxWorkingResolution:bilateralFilterRangeSigma:commandQueue:error:
+/// up to small differences near the tiles boundaries, caused by this offset and by the bilateral
+/// filter support exceeding the halo added around each tile. If the working resolution of
+/// \c texture is empty, an empty array is returned.
+///
+/// @param texture input image. Must have 4 channels of type uchar.
+///
+/// @param maxTileSize maximum size, in pixels of \c texture, of each dimension of a tile, including
+/// its halo. A tile always contains at least one working resolution pixel besides its halo, so
+/// this size is exceeded if it is smaller than a few working resolution pixels.
+///
+/// @param maxWorkingResolution maximum resolution of image to process. Larger images are resized so
+/// that their largest dimension equals this value.
+///
+/// @param bilateralFilterRangeSigma range sigma passed to \c LITBilateralFilterProcessor in
+/// preprocessing step.
+///
+/// @param commandQueue command queue on which to perform the preprocessing calculation.
+///
+/// @param error output error if an error occurs.
+///
+- (nullable NSArray<LITDominantColor*> *)findDominantColorsByStreamingImage:
+    (id<MTLTexture>)texture maxTileSize:(unsigned int)maxTileSize
+    maxWorkingResolution:(unsigned int)maxWorkingResolution
+    bilateralFilterRangeSigma:(float)bilateralFilterRangeSigma
+    commandQueue:(id<MTLCommandQueue>)commandQueue error:(NSError **)error;
 @end
 
 NS_ASSUME_NONNULL_END
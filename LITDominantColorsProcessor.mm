@@ -3,6 +3,8 @@
 
 #import "LITDominantColorsProcessor.h"
 
+#import <mutex>
+
 #import <MetalToolbox/MTBCommandBuffer.h>
 #import <MetalToolbox/MTBDevice.h>
 #import <MetalToolbox/MTBTexture.h>
@@ -104,8 +106,21 @@ static const LITDominantColorRepresentativesPickerConfiguration
     maxWorkingResolution:(unsigned int)maxWorkingResolution
     bilateralFilterRangeSigma:(float)bilateralFilterRangeSigma
     commandQueue:(id<MTLCommandQueue>)commandQueue error:(NSError **)error {
+  return [self findDominantColorsInImage:texture mask:nil maxWorkingResolution:maxWorkingResolution
+               bilateralFilterRangeSigma:bilateralFilterRangeSigma commandQueue:commandQueue
+                                   error:error];
+}
+
+- (nullable NSArray<LITDominantColor*> *)findDominantColorsInImage:(id<MTLTexture>)texture
+    mask:(nullable id<MTLTexture>)mask maxWorkingResolution:(unsigned int)maxWorkingResolution
+    bilateralFilterRangeSigma:(float)bilateralFilterRangeSigma
+    commandQueue:(id<MTLCommandQueue>)commandQueue error:(NSError **)error {
   [LITImageValidator validateImage:texture
                    forPixelFormats:{MTLPixelFormatRGBA8Unorm, MTLPixelFormatBGRA8Unorm}];
+  if (mask) {
+    [[LITImageValidator validateTexture:nn(mask) forPixelFormats:{MTLPixelFormatR8Unorm}]
+        validateTexture:nn(mask) forSameSizeAsTexture:texture];
+  }
 
   // preprocessing consists of resolution reduction + bilateral filtering + conversion RGB to HSV
   // color space.
@@ -116,28 +131,108 @@ static const LITDominantColorRepresentativesPickerConfiguration
     return nil;
   }
 
-  __block std::vector<ScoredColor> filteredDominantColors;
+  // Only pixels inside \c spans are read from the working image, so a small masked region doesn't
+  // require full image passes.
+  cv::Size workingSize((int)HSVImage.width, (int)HSVImage.height);
+  auto spans = mask ? pixelSpansFromMaskTexture(nn(mask), workingSize) :
+      pixelSpansOfSize(workingSize);
+  if (spans.empty()) {
+    return [NSArray array];
+  }
+
+  __block HSVHistogramAccumulator histogram;
   [mtb(HSVImage) mtb_mappedForReading:^(const cv::Mat &HSVMat) {
-    // HSVImage is a HSV 4 channels texture. so convert RGBA2RGB in order to remove the forth
-    // channel.
-    cv::Mat3b hsv;
-    cv::cvtColor(HSVMat, hsv, cv::COLOR_RGBA2RGB);
-
-    auto dominantColorsHSV = [self dominantColorValuesFromHSVImage:hsv];
-    if(dominantColorsHSV.empty()) {
-      return;
-    }
-    auto dominantColorsLUV = [self convertListFromHSVToLUV:dominantColorsHSV];
-    auto luvImage = [self convertImageFromHSVToLUV:hsv];
-    auto scoredDominantColor = [self sortedLUVColorsByScore:dominantColorsLUV inLUVImage:luvImage];
-    filteredDominantColors = filterDominantColors(scoredDominantColor,
-                                                  self.configuration.luvMinDistance);
+    [self accumulatePixelsInSpans:spans ofHSVImage:HSVMat histogram:&histogram];
   }];
 
+  auto filteredDominantColors = [self filteredDominantColorsInHistogram:histogram.entries()];
   auto litDominantColors = [self dominantColorToLITDominantColor:filteredDominantColors];
   return litDominantColors;
 }
 
+- (nullable NSArray<LITDominantColor*> *)findDominantColorsByStreamingImage:
+    (id<MTLTexture>)texture maxTileSize:(unsigned int)maxTileSize
+    maxWorkingResolution:(unsigned int)maxWorkingResolution
+    bilateralFilterRangeSigma:(float)bilateralFilterRangeSigma
+    commandQueue:(id<MTLCommandQueue>)commandQueue error:(NSError **)error {
+  [LITImageValidator validateImage:texture
+                   forPixelFormats:{MTLPixelFormatRGBA8Unorm, MTLPixelFormatBGRA8Unorm}];
+
+  cv::Size sourceSize((int)texture.width, (int)texture.height);
+  auto workingRect = [self workingRectOfImageWithSize:sourceSize
+                                 maxWorkingResolution:maxWorkingResolution];
+  // An extreme aspect ratio may truncate the short side of the working resolution to zero, which
+  // leaves no pixels to analyze.
+  if (workingRect.empty()) {
+    return [NSArray array];
+  }
+  auto tiles = [self workingTilesWithSourceSize:sourceSize workingRect:workingRect
+                                    maxTileSize:maxTileSize];
+
+  HSVHistogramAccumulator histogram;
+  NSError *tilesError = nil;
+  std::mutex histogramMutex;
+  std::mutex encodingMutex;
+  cv::parallel_for_(cv::Range(0, (int)tiles.size()), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; i++) {
+      NSError *tileError;
+      HSVHistogramAccumulator tileHistogram;
+      auto success = [self accumulateWorkingTile:tiles[i] inImage:texture
+                                    workingRect:workingRect
+                      bilateralFilterRangeSigma:bilateralFilterRangeSigma
+                                   commandQueue:commandQueue encodingMutex:&encodingMutex
+                                      histogram:&tileHistogram error:&tileError];
+
+      std::lock_guard<std::mutex> lock(histogramMutex);
+      if (!success) {
+        tilesError = tileError;
+        continue;
+      }
+      histogram.merge(tileHistogram);
+    }
+  });
+
+  if (tilesError) {
+    if (error) {
+      *error = tilesError;
+    }
+    return nil;
+  }
+
+  // The analysis doesn't depend on the spatial layout of the pixels, so the merged histogram is
+  // analyzed directly.
+  auto histogramEntries = histogram.entries();
+  if (histogramEntries.empty()) {
+    return [NSArray array];
+  }
+  auto filteredDominantColors = [self filteredDominantColorsInHistogram:histogramEntries];
+  return [self dominantColorToLITDominantColor:filteredDominantColors];
+}
+
+- (void)accumulatePixelsInSpans:(const std::vector<PixelSpan> &)spans
+                     ofHSVImage:(const cv::Mat4b &)HSVImage
+                      histogram:(HSVHistogramAccumulator *)histogram {
+  /// \c HSVImage is a HSV 4 channels image, only its first 3 channels are accumulated.
+  for (auto &span : spans) {
+    for (int j = span.startColumn; j < span.endColumn; j++) {
+      auto &pixel = HSVImage(span.row, j);
+      histogram->addPixel(cv::Vec3b(pixel(0), pixel(1), pixel(2)));
+    }
+  }
+}
+
+- (std::vector<ScoredColor>)filteredDominantColorsInHistogram:
+    (const std::vector<HSVHistogramEntry> &)histogramEntries {
+  auto dominantColorsHSV = [self dominantColorValuesFromHistogram:histogramEntries];
+  if(dominantColorsHSV.empty()) {
+    return {};
+  }
+  auto dominantColorsLUV = [self convertListFromHSVToLUV:dominantColorsHSV];
+  auto scoredDominantColor = [self sortedLUVColorsByScore:dominantColorsLUV
+                                              inHistogram:histogramEntries];
+  return filterDominantColors(scoredDominantColor, self.configuration.luvMinDistance);
+}
+
 - (nullable id<MTLTexture>)preprocessedImage:(id<MTLTexture>)texture
                         maxWorkingResolution:(unsigned int)maxWorkingResolution
                    bilateralFilterRangeSigma:(float)bilateralFilterRangeSigma
@@ -171,10 +266,151 @@ static const LITDominantColorRepresentativesPickerConfiguration
   return destination;
 }
 
-- (std::vector<cv::Vec3b>)dominantColorValuesFromHSVImage:(cv::Mat3b)hsvImage {
+#pragma mark -
+#pragma mark Streaming
+#pragma mark -
+
+/// Number of working resolution pixels added around each tile, so that the bilateral
+/// filter results in the tile interior are barely affected by the tile boundaries.
+///
+/// The halo is not derived from the filter support: \c LITDominantColorPreprocessor encodes
+/// \c LITBilateralFilter with its fast approximation and without a spatial parameter, and the
+/// filter doesn't expose the radius it uses, so no halo is guaranteed to make the tiles exact. The
+/// value is an empirical margin, and the remaining differences are bounded by the tolerance of the
+/// streaming spec rather than by construction. It should be revisited if the filter configuration
+/// in the preprocessor changes.
+static const int kWorkingTileHalo = 4;
+
+/// Returns the length along an axis, in working pixels, of tiles whose halo tiles cover at most
+/// \c maxTileSize source pixels. The source rect of a halo tile is rounded out to whole source
+/// pixels, which adds at most 2 source pixels to its extent. The length is at least 1, so a
+/// \c maxTileSize too small to hold a single working pixel with its halo is exceeded.
+static int workingTileLength(int sourceLength, int workingLength, unsigned int maxTileSize) {
+  if (maxTileSize >= (unsigned int)sourceLength) {
+    return workingLength;
+  }
+  auto maxWorkingLength = (int)(((int64_t)maxTileSize - 2) * workingLength / sourceLength);
+  return std::max(maxWorkingLength - 2 * kWorkingTileHalo, 1);
+}
+
+- (cv::Rect)workingRectOfImageWithSize:(cv::Size)sourceSize
+                  maxWorkingResolution:(unsigned int)maxWorkingResolution {
+  /// Same resolution reduction as in \c preprocessedImage:maxWorkingResolution:...
+  auto scale = (double)maxWorkingResolution / std::max(sourceSize.width, sourceSize.height);
+  return cv::Rect(0, 0, (int)(scale * sourceSize.width), (int)(scale * sourceSize.height));
+}
+
+- (std::vector<cv::Rect>)workingTilesWithSourceSize:(cv::Size)sourceSize
+                                        workingRect:(cv::Rect)workingRect
+                                        maxTileSize:(unsigned int)maxTileSize {
+  /// Tiles are defined in working resolution, such that each tile together with its halo covers at
+  /// most \c maxTileSize pixels of the source image in each dimension.
+  auto tileWidth = workingTileLength(sourceSize.width, workingRect.width, maxTileSize);
+  auto tileHeight = workingTileLength(sourceSize.height, workingRect.height, maxTileSize);
+
+  std::vector<cv::Rect> tiles;
+  for (int y = 0; y < workingRect.height; y += tileHeight) {
+    for (int x = 0; x < workingRect.width; x += tileWidth) {
+      tiles.push_back(cv::Rect(x, y, tileWidth, tileHeight) & workingRect);
+    }
+  }
+  return tiles;
+}
+
+- (cv::Rect)haloTileOfWorkingTile:(cv::Rect)tile workingRect:(cv::Rect)workingRect {
+  cv::Rect haloTile(tile.x - kWorkingTileHalo, tile.y - kWorkingTileHalo,
+                    tile.width + 2 * kWorkingTileHalo, tile.height + 2 * kWorkingTileHalo);
+  return haloTile & workingRect;
+}
+
+- (cv::Rect)sourceRectOfHaloTile:(cv::Rect)haloTile sourceSize:(cv::Size)sourceSize
+                     workingRect:(cv::Rect)workingRect {
+  /// The exact source extent of \c haloTile is fractional. It is rounded out to whole source
+  /// pixels, and the tile is resized from the rounded rect, so the tile grid may be offset from the
+  /// global working grid by less than 2 source pixels.
+  auto scaleX = (double)sourceSize.width / workingRect.width;
+  auto scaleY = (double)sourceSize.height / workingRect.height;
+  auto left = (int)std::floor(haloTile.x * scaleX);
+  auto top = (int)std::floor(haloTile.y * scaleY);
+  auto right = std::min((int)std::ceil(haloTile.br().x * scaleX), sourceSize.width);
+  auto bottom = std::min((int)std::ceil(haloTile.br().y * scaleY), sourceSize.height);
+  return cv::Rect(left, top, right - left, bottom - top);
+}
+
+- (BOOL)accumulateWorkingTile:(cv::Rect)tile inImage:(id<MTLTexture>)texture
+                  workingRect:(cv::Rect)workingRect
+    bilateralFilterRangeSigma:(float)bilateralFilterRangeSigma
+                 commandQueue:(id<MTLCommandQueue>)commandQueue
+                encodingMutex:(std::mutex *)encodingMutex
+                    histogram:(HSVHistogramAccumulator *)histogram error:(NSError **)error {
+  auto device = commandQueue.device;
+
+  auto haloTile = [self haloTileOfWorkingTile:tile workingRect:workingRect];
+  auto sourceRect = [self sourceRectOfHaloTile:haloTile
+                                    sourceSize:cv::Size((int)texture.width, (int)texture.height)
+                                   workingRect:workingRect];
+  auto sourceX = (NSUInteger)sourceRect.x;
+  auto sourceY = (NSUInteger)sourceRect.y;
+  auto sourceWidth = (NSUInteger)sourceRect.width;
+  auto sourceHeight = (NSUInteger)sourceRect.height;
+
+  auto sourceTile = [mtb(device) mtb_newIOSurfaceBackedTextureWithWidth:sourceWidth
+                                                                 height:sourceHeight
+                                                            pixelFormat:texture.pixelFormat
+                                                                  usage:MTLTextureUsageShaderRead];
+  auto destinationTile = [mtb(device)
+                          mtb_newIOSurfaceBackedTextureWithWidth:haloTile.width
+                                                          height:haloTile.height
+                                                     pixelFormat:MTLPixelFormatRGBA8Unorm
+                                                           usage:MTLTextureUsageShaderWrite];
+
+  /// The preprocessor kernels are shared by all the tiles and are not safe to encode from several
+  /// threads at once, so encoding is serialized. Waiting for the GPU, reading back the tile and
+  /// accumulating its histogram run concurrently.
+  id<MTLCommandBuffer> commandBuffer;
+  {
+    std::lock_guard<std::mutex> lock(*encodingMutex);
+    commandBuffer = [commandQueue commandBuffer];
+    auto blitEncoder = [commandBuffer blitCommandEncoder];
+    [blitEncoder copyFromTexture:texture sourceSlice:0 sourceLevel:0
+                    sourceOrigin:MTLOriginMake(sourceX, sourceY, 0)
+                      sourceSize:MTLSizeMake(sourceWidth, sourceHeight, 1)
+                       toTexture:sourceTile destinationSlice:0 destinationLevel:0
+               destinationOrigin:MTLOriginMake(0, 0, 0)];
+    [blitEncoder endEncoding];
+    [self.preprocessor encodeToCommandBuffer:commandBuffer sourceTexture:sourceTile
+                          destinationTexture:destinationTile
+                   bilateralFilterRangeSigma:bilateralFilterRangeSigma];
+    [commandBuffer commit];
+  }
+  [commandBuffer waitUntilCompleted];
+
+  if (commandBuffer.status != MTLCommandBufferStatusCompleted) {
+    if (error) {
+      *error = commandBuffer.error;
+    }
+    return NO;
+  }
+
+  auto tileInHaloTile = tile - haloTile.tl();
+  [mtb(destinationTile) mtb_mappedForReading:^(const cv::Mat &HSVMat) {
+    [self accumulatePixelsInSpans:pixelSpansOfSize(tile.size())
+                       ofHSVImage:HSVMat(tileInHaloTile) histogram:histogram];
+  }];
+  return YES;
+}
+
+#pragma mark -
+#pragma mark Dominant Colors Extraction
+#pragma mark -
+
+- (std::vector<cv::Vec3b>)dominantColorValuesFromHistogram:
+    (const std::vector<HSVHistogramEntry> &)histogramEntries {
   std::vector<std::vector<cv::Vec3b>> imageBins;
-  auto hsvHistogram = [self calculateHSVHistogramForImage:hsvImage populateBins:&imageBins];
-  auto sortedHSBinIndexes = [self hsBinIndexesSortedBySize:imageBins];
+  std::vector<int> imageBinSizes;
+  auto hsvHistogram = [self calculateHSVHistogramForEntries:histogramEntries
+                                               populateBins:&imageBins binSizes:&imageBinSizes];
+  auto sortedHSBinIndexes = [self hsBinIndexesSortedBySize:imageBinSizes];
 
   std::vector<cv::Vec3b> dominantColorsHSV;
   auto binsToIterate = std::min(self.configuration.numOfBinsInHField *
@@ -225,13 +461,6 @@ static const LITDominantColorRepresentativesPickerConfiguration
   return litDominantColors;
 }
 
-- (cv::Mat3b)convertImageFromHSVToLUV:(const cv::Mat3b &)imageHSV {
-  cv::Mat3b imageLUV;
-  cv::cvtColor(imageHSV, imageLUV, cv::COLOR_HSV2RGB);
-  cv::cvtColor(imageLUV, imageLUV, cv::COLOR_RGB2Luv);
-  return imageLUV;
-}
-
 - (void)addNewBinDominantColors:(const std::vector<cv::Vec3b> &)binDominantColors
                          toList:(std::vector<cv::Vec3b> *)dominantColors {
   int addedDominantColorsInCurrentBin = 0;
@@ -256,46 +485,50 @@ static const LITDominantColorRepresentativesPickerConfiguration
   return true;
 }
 
-- (cv::Mat1f)calculateHSVHistogramForImage:(cv::Mat3b)hsvImage
-                              populateBins:(std::vector<std::vector<cv::Vec3b>> *)bins {
+- (cv::Mat1f)calculateHSVHistogramForEntries:
+    (const std::vector<HSVHistogramEntry> &)histogramEntries
+    populateBins:(std::vector<std::vector<cv::Vec3b>> *)bins
+    binSizes:(std::vector<int> *)binSizes {
   /// Values range of H channel is [0, 180].
   int histSize[3] = {180, 256, 256};
   cv::Mat1f hsvHistogram = cv::Mat::zeros(3, histSize, CV_32FC1);
 
-  bins->resize(self.configuration.numOfBinsInHField * self.configuration.numOfBinsInSField);
-  for (int i = 0; i < hsvImage.rows; i++) {
-    for (int j = 0; j < hsvImage.cols; j++) {
-      auto pixel = hsvImage(i, j);
-      if ([self shouldIgnorePixel:pixel]) {
-        continue;
-      }
-      int hBinIndex = pixel(0) / self.binWidthH;
-      int sBinIndex = pixel(1) / self.binWidthS;
-      (*bins)[hBinIndex * self.configuration.numOfBinsInSField + sBinIndex].push_back(pixel);
-
-      hsvHistogram(pixel(0), pixel(1), pixel(2)) += 1;
+  /// Each bin holds the distinct values that fall in it, and \c binSizes holds the number of
+  /// pixels in each bin.
+  auto numberOfBins = self.configuration.numOfBinsInHField * self.configuration.numOfBinsInSField;
+  bins->resize(numberOfBins);
+  binSizes->assign(numberOfBins, 0);
+  for (auto &[pixel, count] : histogramEntries) {
+    if ([self shouldIgnorePixel:pixel]) {
+      continue;
     }
+    int hBinIndex = pixel(0) / self.binWidthH;
+    int sBinIndex = pixel(1) / self.binWidthS;
+    auto binIndex = hBinIndex * self.configuration.numOfBinsInSField + sBinIndex;
+    (*bins)[binIndex].push_back(pixel);
+    (*binSizes)[binIndex] += count;
+
+    hsvHistogram(pixel(0), pixel(1), pixel(2)) = count;
   }
   return hsvHistogram;
 }
 
-- (std::vector<LITHSBinIndex>)hsBinIndexesSortedBySize:(const std::vector<std::vector<cv::Vec3b>> &)
-    bins {
+- (std::vector<LITHSBinIndex>)hsBinIndexesSortedBySize:(const std::vector<int> &)binSizes {
   std::vector<LITHSBinIndex> binIndexes;
   for (unsigned int i = 0; i < self.configuration.numOfBinsInHField; i++) {
     for (unsigned int j = 0; j < self.configuration.numOfBinsInSField; j++) {
       binIndexes.push_back(LITHSBinIndex(i, j));
     }
   }
-  auto compare = [&bins, &self](const LITHSBinIndex &left, LITHSBinIndex &right) {
-    float priorityLeft = bins[left.hueIndex * self.configuration.numOfBinsInSField +
-                              left.saturationIndex].size();
+  auto compare = [&binSizes, &self](const LITHSBinIndex &left, LITHSBinIndex &right) {
+    float priorityLeft = binSizes[left.hueIndex * self.configuration.numOfBinsInSField +
+                                  left.saturationIndex];
     auto priorityTendencyToSaturationFactorLeft = 1 + ((float)left.saturationIndex /
                                                    (self.configuration.numOfBinsInSField - 1) *
                                                    self.configuration.saturatedPriorityFactor);
 
-    float priorityRight = bins[right.hueIndex * self.configuration.numOfBinsInSField +
-                              right.saturationIndex].size();
+    float priorityRight = binSizes[right.hueIndex * self.configuration.numOfBinsInSField +
+                                   right.saturationIndex];
     auto priorityTendencyToSaturationFactorRight = 1 + ((float)right.saturationIndex /
                                                    (self.configuration.numOfBinsInSField - 1) *
                                                    self.configuration.saturatedPriorityFactor);
@@ -311,35 +544,52 @@ static const LITDominantColorRepresentativesPickerConfiguration
 #pragma mark -
 
 - (std::vector<ScoredColor>)sortedLUVColorsByScore:(const std::vector<cv::Vec3b> &)colors
-                                        inLUVImage:(const cv::Mat3b &)imageLUV {
+                                       inHistogram:
+    (const std::vector<HSVHistogramEntry> &)histogramEntries {
   auto dominantColorsSize = (int)colors.size();
-  /// \c distancesMat has rows as the number of pixels and columns as the number of dominant colors.
-  /// Each entry contain 1 if the distance in LUV color space between the appropriate pixel and
-  /// dominant color is below threshold, and 0 otherwise.
-  cv::Mat1f distancesMat = cv::Mat1f::zeros(imageLUV.cols * imageLUV.rows, dominantColorsSize);
-  int cols = imageLUV.cols;
   static const float kMaxOverlappingAreaBetweenPotentialDominantColors = 1.0 / 3.0;
   auto factor = (1 - kMaxOverlappingAreaBetweenPotentialDominantColors);
   auto distanceTreshold = self.configuration.luvMinDistance * factor;
-  imageLUV.forEach([&dominantColorsSize, &distancesMat, &colors ,&cols, &distanceTreshold]
-                   (cv::Vec3b &pixel, const int position[]) {
-    auto distancesMatRow = position[0] * cols + position[1];
-    for (int i = 0; i < dominantColorsSize; i++) {
-      auto euclideanDist = cv::norm(cv::Vec3i(pixel) - cv::Vec3i(colors[i]),
-                                    cv::NormTypes::NORM_L2);
-      if (euclideanDist < distanceTreshold) {
-        distancesMat(distancesMatRow, i) = 1;
+
+  /// Each distinct histogram value is converted to LUV color space once.
+  int numberOfEntries = (int)histogramEntries.size();
+  cv::Mat3b hsvValues(numberOfEntries, 1);
+  int numberOfPixels = 0;
+  for (int entryIndex = 0; entryIndex < numberOfEntries; entryIndex++) {
+    hsvValues(entryIndex) = histogramEntries[entryIndex].hsv;
+    numberOfPixels += histogramEntries[entryIndex].count;
+  }
+  cv::Mat3b luvValues;
+  cv::cvtColor(hsvValues, luvValues, cv::COLOR_HSV2RGB);
+  cv::cvtColor(luvValues, luvValues, cv::COLOR_RGB2Luv);
+
+  /// Each entry of \c scoreList counts the pixels whose distance in LUV color space to the
+  /// appropriate dominant color is below threshold.
+  std::vector<int> scoreList(dominantColorsSize);
+  std::mutex scoreListMutex;
+  cv::parallel_for_(cv::Range(0, numberOfEntries), [&](const cv::Range &range) {
+    std::vector<int> rangeScoreList(dominantColorsSize);
+    for (int entryIndex = range.start; entryIndex < range.end; entryIndex++) {
+      auto &value = luvValues(entryIndex);
+      for (int i = 0; i < dominantColorsSize; i++) {
+        auto euclideanDist = cv::norm(cv::Vec3i(value) - cv::Vec3i(colors[i]),
+                                      cv::NormTypes::NORM_L2);
+        if (euclideanDist < distanceTreshold) {
+          rangeScoreList[i] += histogramEntries[entryIndex].count;
+        }
       }
     }
-  });
 
-  std::vector<float> scoreList;
-  cv::reduce(distancesMat, scoreList, 0, cv::REDUCE_SUM);
+    std::lock_guard<std::mutex> lock(scoreListMutex);
+    for (int i = 0; i < dominantColorsSize; i++) {
+      scoreList[i] += rangeScoreList[i];
+    }
+  });
 
   std::vector<ScoredColor> scoredDominantColorList;
   scoredDominantColorList.resize(dominantColorsSize);
   for (int i = 0; i < dominantColorsSize; i++) {
-    auto normalizedScore = scoreList[i] / imageLUV.rows / imageLUV.cols;
+    auto normalizedScore = (float)scoreList[i] / numberOfPixels;
     scoredDominantColorList[i] = ScoredColor{colors[i], normalizedScore};
   }
 
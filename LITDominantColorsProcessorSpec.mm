@@ -5,6 +5,17 @@
 
 #import "LITDominantColorSharedExamples.h"
 
+@interface LITDominantColorsProcessor (Streaming)
+- (cv::Rect)workingRectOfImageWithSize:(cv::Size)sourceSize
+                  maxWorkingResolution:(unsigned int)maxWorkingResolution;
+- (std::vector<cv::Rect>)workingTilesWithSourceSize:(cv::Size)sourceSize
+                                        workingRect:(cv::Rect)workingRect
+                                        maxTileSize:(unsigned int)maxTileSize;
+- (cv::Rect)haloTileOfWorkingTile:(cv::Rect)tile workingRect:(cv::Rect)workingRect;
+- (cv::Rect)sourceRectOfHaloTile:(cv::Rect)haloTile sourceSize:(cv::Size)sourceSize
+                     workingRect:(cv::Rect)workingRect;
+@end
+
 SpecBegin(LITDominantColor)
 
 __block cv::Mat4b inputMat;
@@ -43,6 +54,200 @@ it(@"should return empty dominant colors list on grayscale image", ^{
   expect(dominantColors.count).to.equal(0);
 });
 
+context(@"mask", ^{
+  __block id<MTLTexture> input;
+  __block id<MTLTexture> mask;
+  __block id<MTLCommandQueue> commandQueue;
+
+  const int kMaxWorkingResolution = 128;
+  const float kBilateralFilterRangeSigma = 0.3;
+
+  beforeEach(^{
+    input = [mtb(device) mtb_newIOSurfaceBackedTextureWithWidth:inputMat.cols
+                                                         height:inputMat.rows
+                                                    pixelFormat:MTLPixelFormatRGBA8Unorm];
+    [input mtb_mappedForWriting:^(cv::Mat *mat) {
+      inputMat.copyTo(*mat);
+    }];
+    mask = [mtb(device) mtb_newIOSurfaceBackedTextureWithWidth:inputMat.cols
+                                                        height:inputMat.rows
+                                                   pixelFormat:MTLPixelFormatR8Unorm];
+    commandQueue = [device newCommandQueue];
+  });
+
+  it(@"should find the same dominant colors with a full mask as without mask", ^{
+    [mask mtb_mappedForWriting:^(cv::Mat *mat) {
+      mat->setTo(255);
+    }];
+
+    NSError *error;
+    auto dominantColors = [processor findDominantColorsInImage:input
+                                          maxWorkingResolution:kMaxWorkingResolution
+                                     bilateralFilterRangeSigma:kBilateralFilterRangeSigma
+                                                  commandQueue:commandQueue error:&error];
+    auto maskedDominantColors = [processor findDominantColorsInImage:input mask:mask
+                                                maxWorkingResolution:kMaxWorkingResolution
+                                           bilateralFilterRangeSigma:kBilateralFilterRangeSigma
+                                                        commandQueue:commandQueue error:&error];
+
+    expect(maskedDominantColors.count).to.equal(dominantColors.count);
+    for (NSUInteger i = 0; i < dominantColors.count; i++) {
+      expect(maskedDominantColors[i].color).to.equal(dominantColors[i].color);
+      expect(maskedDominantColors[i].score).to.equal(dominantColors[i].score);
+    }
+  });
+
+  it(@"should return empty dominant colors list on an empty mask", ^{
+    [mask mtb_mappedForWriting:^(cv::Mat *mat) {
+      mat->setTo(0);
+    }];
+
+    NSError *error;
+    auto dominantColors = [processor findDominantColorsInImage:input mask:mask
+                                          maxWorkingResolution:kMaxWorkingResolution
+                                     bilateralFilterRangeSigma:kBilateralFilterRangeSigma
+                                                  commandQueue:commandQueue error:&error];
+    expect(dominantColors.count).to.equal(0);
+  });
+
+  it(@"should find dominant colors only inside the mask", ^{
+    cv::Mat4b image(128, 128, cv::Scalar(255, 0, 0, 255));
+    image.colRange(64, 128).setTo(cv::Scalar(0, 0, 255, 255));
+    [input mtb_mappedForWriting:^(cv::Mat *mat) {
+      image.copyTo(*mat);
+    }];
+    [mask mtb_mappedForWriting:^(cv::Mat *mat) {
+      mat->setTo(0);
+      mat->colRange(0, 64).setTo(255);
+    }];
+
+    NSError *error;
+    auto dominantColors = [processor findDominantColorsInImage:input mask:mask
+                                          maxWorkingResolution:kMaxWorkingResolution
+                                     bilateralFilterRangeSigma:kBilateralFilterRangeSigma
+                                                  commandQueue:commandQueue error:&error];
+
+    expect(dominantColors.count).to.equal(1);
+    CGFloat red, green, blue;
+    [dominantColors.firstObject.color getRed:&red green:&green blue:&blue alpha:nil];
+    expect(red).to.beCloseToWithin(1, 6 / 255.0);
+    expect(green).to.beCloseToWithin(0, 6 / 255.0);
+    expect(blue).to.beCloseToWithin(0, 6 / 255.0);
+    expect(dominantColors.firstObject.score).to.beCloseToWithin(1, 0.05);
+  });
+});
+
+context(@"streaming", ^{
+  __block id<MTLCommandQueue> commandQueue;
+
+  const float kBilateralFilterRangeSigma = 0.3;
+
+  beforeEach(^{
+    commandQueue = [device newCommandQueue];
+  });
+
+  auto textureFromMat = ^id<MTLTexture>(const cv::Mat4b &mat) {
+    auto texture = [mtb(device) mtb_newIOSurfaceBackedTextureWithWidth:mat.cols height:mat.rows
+                                                            pixelFormat:MTLPixelFormatRGBA8Unorm];
+    [texture mtb_mappedForWriting:^(cv::Mat *textureMat) {
+      mat.copyTo(*textureMat);
+    }];
+    return texture;
+  };
+
+  auto expectStreamedDominantColors = ^(id<MTLTexture> input, unsigned int maxWorkingResolution,
+                                        unsigned int maxTileSize) {
+    NSError *error;
+    auto dominantColors = [processor findDominantColorsInImage:input
+                                          maxWorkingResolution:maxWorkingResolution
+                                     bilateralFilterRangeSigma:kBilateralFilterRangeSigma
+                                                  commandQueue:commandQueue error:&error];
+    auto streamedDominantColors =
+        [processor findDominantColorsByStreamingImage:input maxTileSize:maxTileSize
+                                 maxWorkingResolution:maxWorkingResolution
+                            bilateralFilterRangeSigma:kBilateralFilterRangeSigma
+                                         commandQueue:commandQueue error:&error];
+
+    expect(error).to.beNil();
+    expect(streamedDominantColors.count).to.equal(dominantColors.count);
+    for (NSUInteger i = 0; i < std::min(dominantColors.count, streamedDominantColors.count); i++) {
+      CGFloat red, green, blue;
+      [dominantColors[i].color getRed:&red green:&green blue:&blue alpha:nil];
+      CGFloat streamedRed, streamedGreen, streamedBlue;
+      [streamedDominantColors[i].color getRed:&streamedRed green:&streamedGreen
+                                         blue:&streamedBlue alpha:nil];
+      expect(streamedRed).to.beCloseToWithin(red, 6 / 255.0);
+      expect(streamedGreen).to.beCloseToWithin(green, 6 / 255.0);
+      expect(streamedBlue).to.beCloseToWithin(blue, 6 / 255.0);
+      expect(streamedDominantColors[i].score).to.beCloseToWithin(dominantColors[i].score, 0.02);
+    }
+  };
+
+  auto expectTiles = ^(cv::Size sourceSize, unsigned int maxWorkingResolution,
+                       unsigned int maxTileSize, NSUInteger expectedNumberOfTiles) {
+    auto workingRect = [processor workingRectOfImageWithSize:sourceSize
+                                        maxWorkingResolution:maxWorkingResolution];
+    auto tiles = [processor workingTilesWithSourceSize:sourceSize workingRect:workingRect
+                                           maxTileSize:maxTileSize];
+    expect(tiles.size()).to.equal(expectedNumberOfTiles);
+
+    int tilesArea = 0;
+    for (auto &tile : tiles) {
+      expect((tile & workingRect) == tile).to.beTruthy();
+      tilesArea += tile.area();
+
+      auto haloTile = [processor haloTileOfWorkingTile:tile workingRect:workingRect];
+      auto sourceRect = [processor sourceRectOfHaloTile:haloTile sourceSize:sourceSize
+                                            workingRect:workingRect];
+      expect(sourceRect.width).to.beLessThanOrEqualTo(maxTileSize);
+      expect(sourceRect.height).to.beLessThanOrEqualTo(maxTileSize);
+    }
+    expect(tilesArea).to.equal(workingRect.area());
+  };
+
+  it(@"should find dominant colors by streaming the image tile by tile", ^{
+    cv::Mat4b largeInputMat;
+    cv::resize(inputMat, largeInputMat, cv::Size(inputMat.cols * 4, inputMat.rows * 4));
+    expectStreamedDominantColors(textureFromMat(largeInputMat), 128, 128);
+  });
+
+  context(@"source size not divisible by working size", ^{
+    __block cv::Mat4b unevenInputMat;
+
+    beforeEach(^{
+      cv::Mat4b lemur = LTLoadMatFromBundle(NSBundle.lt_testBundle, @"lemur.png");
+      cv::resize(lemur, unevenInputMat, cv::Size(509, 383), 0, 0, cv::INTER_AREA);
+    });
+
+    it(@"should split the working image to tiles bounded by the tile size", ^{
+      expectTiles(unevenInputMat.size(), 128, 100, 48);
+      expectTiles(unevenInputMat.size(), 200, 150, 16);
+    });
+
+    it(@"should cover the working image by a single tile for a tile size of the image", ^{
+      expectTiles(unevenInputMat.size(), 128, 509, 1);
+    });
+
+    it(@"should find dominant colors by streaming the image tile by tile", ^{
+      auto input = textureFromMat(unevenInputMat);
+      expectStreamedDominantColors(input, 128, 100);
+      expectStreamedDominantColors(input, 200, 150);
+    });
+  });
+
+  it(@"should return empty dominant colors list on an empty working resolution", ^{
+    cv::Mat4b thinInputMat(1, 512, cv::Vec4b(255, 0, 0, 255));
+    NSError *error;
+    auto dominantColors =
+        [processor findDominantColorsByStreamingImage:textureFromMat(thinInputMat)
+                                          maxTileSize:128 maxWorkingResolution:128
+                            bilateralFilterRangeSigma:kBilateralFilterRangeSigma
+                                         commandQueue:commandQueue error:&error];
+    expect(error).to.beNil();
+    expect(dominantColors.count).to.equal(0);
+  });
+});
+
 itBehavesLike(kLITDominantColorExamples, ^{
   auto input = [mtb(device) mtb_newIOSurfaceBackedTextureWithWidth:inputMat.cols
                                                             height:inputMat.rows
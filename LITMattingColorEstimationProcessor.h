@@ -31,6 +31,9 @@ LT_C_DECLS_END
 ///
 /// The algorithm is implemented here:
 ///https://github.com/pymatting/pymatting/blob/master/pymatting/foreground/estimate_foreground_ml.py
+///
+/// @note This processor keeps the whole pyramid in memory. For very large images, use
+/// \c LITMattingColorEstimationTiledProcessor.
 @interface LITMattingColorEstimationProcessor : NSObject
 
 - (instancetype)init NS_UNAVAILABLE;
@@ -0,0 +1,11 @@
+// Copyright (c) 2020 Lightricks. All rights reserved.
+// Created by Roni Shahino.
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Combines \c image1 and \c image2 by \c mask, as <tt>image1 * mask + image2 * (1 - mask)</tt>.
+/// \c image1 and \c image2 must have 4 channels of type uchar, and \c mask must have 1 channel of
+/// type uchar. All must have the same size.
+cv::Mat4b LITCombineImagesByMask(cv::Mat image1, cv::Mat image2, cv::Mat mask);
+
+NS_ASSUME_NONNULL_END
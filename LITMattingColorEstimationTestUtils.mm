@@ -0,0 +1,31 @@
+// Copyright (c) 2020 Lightricks. All rights reserved.
+// Created by Roni Shahino.
+
+#import "LITMattingColorEstimationTestUtils.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+cv::Mat4b LITCombineImagesByMask(cv::Mat image1, cv::Mat image2, cv::Mat mask) {
+  // Combine images by: image1 * mask + image2 * (1 - mask)
+  mask.convertTo(mask, CV_32F, 1 / 255.f);
+  cv::Mat maskMutliChannels;
+  cv::Mat mats[4] = {mask, mask, mask, mask};
+  cv::merge(mats, 4, maskMutliChannels);
+  maskMutliChannels = maskMutliChannels.reshape(1);
+
+  image1.convertTo(image1, CV_32F);
+  image1 = image1.reshape(1);
+  image2.convertTo(image2, CV_32F);
+  image2 = image2.reshape(1);
+
+  cv::Mat combined1, combined2, combinedImage;
+  cv::multiply(image1, maskMutliChannels, combined1);
+  cv::multiply(image2, 1 - maskMutliChannels, combined2);
+  cv::add(combined1, combined2, combinedImage);
+
+  combinedImage.convertTo(combinedImage, CV_8U);
+  combinedImage = combinedImage.reshape(4);
+  return combinedImage;
+}
+
+NS_ASSUME_NONNULL_END
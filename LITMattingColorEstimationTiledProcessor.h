@@ -0,0 +1,51 @@
+// Copyright (c) 2020 Lightricks. All rights reserved.
+// Created by Roni Shahino.
+
+#import "LITMattingColorEstimationProcessor.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Processor estimating the colors of background and foreground objects given a combined image and
+/// alpha, performing the same algorithm as \c LITMattingColorEstimationProcessor on the CPU, tile
+/// by tile. This processor is designed for very large images, whose pyramid doesn't fit in memory.
+///
+/// Coarse pyramid levels that fit in a single tile are solved globally. Finer levels are solved
+/// tile by tile, where each tile is expanded by a halo as wide as the number of iterations
+/// performed on its level, so the tiles results are identical to solving the whole level at once.
+/// Tiles are processed in parallel. Apart from the input and output images, peak memory depends on
+/// the tile size rather than on the image size.
+@interface LITMattingColorEstimationTiledProcessor : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Initializes the processor with \c tileSize, the maximum size of each dimension of a tile.
+/// \c tileSize must be positive.
+- (instancetype)initWithTileSize:(int)tileSize NS_DESIGNATED_INITIALIZER;
+
+/// Computes foreground and background images.
+/// @note Either \c foreground or \c background may be null if only the other is required.
+///
+/// @param image the input image. Must have 4 channels of type uchar, and at least 2 pixels along
+/// its long side.
+///
+/// @param alpha the input alpha matte that defines the foreground object in the image.
+/// Must have 1 channel of type uchar and the same size as \c image.
+///
+/// @param foreground output foreground image. Reallocated to have 4 channels of type uchar and the
+/// same size as \c image.
+///
+/// @param background output background image. Reallocated to have 4 channels of type uchar and the
+/// same size as \c image.
+///
+/// @param configuration configuration parameters.
+- (void)estimateColorsOfImage:(const cv::Mat4b &)image alpha:(const cv::Mat1b &)alpha
+                   foreground:(nullable cv::Mat4b *)foreground
+                   background:(nullable cv::Mat4b *)background
+                configuration:(LITMattingColorEstimationProcessorConfiguration)configuration;
+
+/// Maximum size of each dimension of a tile.
+@property (readonly, nonatomic) int tileSize;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,329 @@
+// Copyright (c) 2020 Lightricks. All rights reserved.
+// Created by Roni Shahino.
+
+#import "LITMattingColorEstimationTiledProcessor.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Structure stores the parameters of a single pyramid level.
+struct LITMattingPyramidLevel {
+  /// Size of the level.
+  cv::Size size;
+
+  /// Number of iterations performed on the level.
+  int numberOfIterations;
+};
+
+/// Structure stores the pyramid being solved.
+struct LITMattingPyramid {
+  /// Full resolution input image.
+  cv::Mat4b image;
+
+  /// Full resolution input alpha.
+  cv::Mat1b alpha;
+
+  /// Pyramid levels, from the coarsest to the finest.
+  std::vector<LITMattingPyramidLevel> levels;
+
+  /// Number of coarse levels that are solved globally.
+  int numberOfGlobalLevels;
+
+  /// Foreground of the last globally solved level.
+  cv::Mat3b globalForeground;
+
+  /// Background of the last globally solved level.
+  cv::Mat3b globalBackground;
+};
+
+/// Structure stores the inputs of the update step in a region of a pyramid level.
+struct LITMattingRegionInputs {
+  /// Image values of the region.
+  cv::Mat3f image;
+
+  /// Alpha values of the region.
+  cv::Mat1f alpha;
+};
+
+@implementation LITMattingColorEstimationTiledProcessor
+
+- (instancetype)initWithTileSize:(int)tileSize {
+  LTParameterAssert(tileSize > 0, @"tileSize must be positive, got %d", tileSize);
+  if (self = [super init]) {
+    _tileSize = tileSize;
+  }
+  return self;
+}
+
+- (void)estimateColorsOfImage:(const cv::Mat4b &)image alpha:(const cv::Mat1b &)alpha
+                   foreground:(nullable cv::Mat4b *)foreground
+                   background:(nullable cv::Mat4b *)background
+                configuration:(LITMattingColorEstimationProcessorConfiguration)configuration {
+  LTParameterAssert(image.size() == alpha.size(), @"alpha size (%d, %d) must be equal to image "
+                    "size (%d, %d)", alpha.cols, alpha.rows, image.cols, image.rows);
+  LTParameterAssert(foreground || background,
+                    @"Either foreground or background must be non null");
+  LTParameterAssert(std::max(image.cols, image.rows) >= 2, @"image size (%d, %d) must be at least "
+                    "2 on its long side", image.cols, image.rows);
+
+  auto pyramid = [self pyramidWithImage:image alpha:alpha configuration:configuration];
+
+  for (int level = 0; level < pyramid.numberOfGlobalLevels; level++) {
+    cv::Mat3b levelForeground, levelBackground;
+    [self solveLevel:level inRect:cv::Rect(cv::Point(0, 0), pyramid.levels[level].size)
+             pyramid:pyramid foreground:&levelForeground background:&levelBackground];
+    pyramid.globalForeground = levelForeground;
+    pyramid.globalBackground = levelBackground;
+  }
+
+  if (foreground) {
+    foreground->create(image.size());
+  }
+  if (background) {
+    background->create(image.size());
+  }
+
+  auto finestLevel = (int)pyramid.levels.size() - 1;
+  if (pyramid.numberOfGlobalLevels == (int)pyramid.levels.size()) {
+    [self writeForeground:pyramid.globalForeground background:pyramid.globalBackground
+                   inRect:cv::Rect(cv::Point(0, 0), image.size())
+        outputForeground:foreground outputBackground:background];
+    return;
+  }
+
+  auto tiles = [self tilesWithSize:pyramid.levels[finestLevel].size];
+  cv::parallel_for_(cv::Range(0, (int)tiles.size()), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; i++) {
+      cv::Mat3b tileForeground, tileBackground;
+      [self solveLevel:finestLevel inRect:tiles[i] pyramid:pyramid foreground:&tileForeground
+            background:&tileBackground];
+      [self writeForeground:tileForeground background:tileBackground inRect:tiles[i]
+           outputForeground:foreground outputBackground:background];
+    }
+  });
+}
+
+- (LITMattingPyramid)pyramidWithImage:(const cv::Mat4b &)image alpha:(const cv::Mat1b &)alpha
+    configuration:(LITMattingColorEstimationProcessorConfiguration)configuration {
+  LITMattingPyramid pyramid;
+  pyramid.image = image;
+  pyramid.alpha = alpha;
+
+  /// Level sizes match those of \c LITMattingColorEstimationProcessor.
+  int width = image.cols;
+  int height = image.rows;
+  int numPyramidLevels =  std::ceil(std::log2(std::max(width, height)));
+  for (int level = 1; level <= numPyramidLevels; level++) {
+    cv::Size size((int)pow(width, ((float)level / numPyramidLevels)),
+                  (int)pow(height, ((float)level / numPyramidLevels)));
+    pyramid.levels.push_back({size, [self numberOfIterationForSize:size
+                                                     configuration:configuration]});
+  }
+
+  /// Levels grow in size, so the levels that fit in a single tile are the coarsest ones.
+  pyramid.numberOfGlobalLevels = 0;
+  for (auto &level : pyramid.levels) {
+    if (level.size.width > self.tileSize || level.size.height > self.tileSize) {
+      break;
+    }
+    pyramid.numberOfGlobalLevels += 1;
+  }
+  return pyramid;
+}
+
+- (int)numberOfIterationForSize:(cv::Size)size
+                  configuration:(LITMattingColorEstimationProcessorConfiguration)configuration {
+  if (size.width <= configuration.smallScalesThreshold &&
+      size.height <= configuration.smallScalesThreshold) {
+    return configuration.numberOfIterationsForSmallScales;
+  } else {
+    return configuration.numberOfIterationsForLargeScales;
+  }
+}
+
+- (std::vector<cv::Rect>)tilesWithSize:(cv::Size)size {
+  std::vector<cv::Rect> tiles;
+  cv::Rect levelRect(cv::Point(0, 0), size);
+  for (int y = 0; y < size.height; y += self.tileSize) {
+    for (int x = 0; x < size.width; x += self.tileSize) {
+      tiles.push_back(cv::Rect(x, y, self.tileSize, self.tileSize) & levelRect);
+    }
+  }
+  return tiles;
+}
+
+#pragma mark -
+#pragma mark Level Solving
+#pragma mark -
+
+- (void)solveLevel:(int)level inRect:(cv::Rect)rect pyramid:(const LITMattingPyramid &)pyramid
+        foreground:(cv::Mat3b *)foreground background:(cv::Mat3b *)background {
+  auto &pyramidLevel = pyramid.levels[level];
+
+  /// Each iteration propagates values by a single pixel, so after \c numberOfIterations iterations
+  /// the values in \c rect are not affected by the boundaries of \c expandedRect that are inside
+  /// the level.
+  auto halo = pyramidLevel.numberOfIterations;
+  cv::Rect expandedRect(rect.x - halo, rect.y - halo, rect.width + 2 * halo,
+                        rect.height + 2 * halo);
+  expandedRect &= cv::Rect(cv::Point(0, 0), pyramidLevel.size);
+
+  cv::Mat3b currentForeground, currentBackground;
+  [self initialForeground:&currentForeground background:&currentBackground ofLevel:level
+                   inRect:expandedRect pyramid:pyramid];
+  auto inputs = [self inputsOfLevel:level inRect:expandedRect pyramid:pyramid];
+
+  cv::Mat3b nextForeground(expandedRect.size());
+  cv::Mat3b nextBackground(expandedRect.size());
+  for (int iteration = 0; iteration < pyramidLevel.numberOfIterations; iteration++) {
+    [self updateStepWithInputs:inputs foreground:currentForeground background:currentBackground
+              outputForeground:&nextForeground outputBackground:&nextBackground];
+    std::swap(currentForeground, nextForeground);
+    std::swap(currentBackground, nextBackground);
+  }
+
+  auto rectInExpandedRect = rect - expandedRect.tl();
+  *foreground = currentForeground(rectInExpandedRect);
+  *background = currentBackground(rectInExpandedRect);
+}
+
+- (void)initialForeground:(cv::Mat3b *)foreground background:(cv::Mat3b *)background
+                  ofLevel:(int)level inRect:(cv::Rect)rect
+                  pyramid:(const LITMattingPyramid &)pyramid {
+  if (level == 0) {
+    *foreground = cv::Mat3b::zeros(rect.size());
+    *background = cv::Mat3b::zeros(rect.size());
+    return;
+  }
+
+  auto &size = pyramid.levels[level].size;
+  auto &previousSize = pyramid.levels[level - 1].size;
+  auto columns = [self nearestNeighborIndicesFrom:rect.x to:rect.br().x size:size.width
+                                       sourceSize:previousSize.width];
+  auto rows = [self nearestNeighborIndicesFrom:rect.y to:rect.br().y size:size.height
+                                    sourceSize:previousSize.height];
+
+  /// Nearest neighbor indices are monotonic, so the region of the previous level that is resized to
+  /// \c rect is spanned by the first and last indices.
+  cv::Rect previousRect(columns.front(), rows.front(), columns.back() - columns.front() + 1,
+                        rows.back() - rows.front() + 1);
+  cv::Mat3b previousForeground, previousBackground;
+  if (level - 1 < pyramid.numberOfGlobalLevels) {
+    previousForeground = pyramid.globalForeground(previousRect);
+    previousBackground = pyramid.globalBackground(previousRect);
+  } else {
+    [self solveLevel:level - 1 inRect:previousRect pyramid:pyramid
+          foreground:&previousForeground background:&previousBackground];
+  }
+
+  foreground->create(rect.size());
+  background->create(rect.size());
+  for (int i = 0; i < rect.height; i++) {
+    for (int j = 0; j < rect.width; j++) {
+      (*foreground)(i, j) = previousForeground(rows[i] - previousRect.y,
+                                               columns[j] - previousRect.x);
+      (*background)(i, j) = previousBackground(rows[i] - previousRect.y,
+                                               columns[j] - previousRect.x);
+    }
+  }
+}
+
+- (LITMattingRegionInputs)inputsOfLevel:(int)level inRect:(cv::Rect)rect
+                                pyramid:(const LITMattingPyramid &)pyramid {
+  auto &size = pyramid.levels[level].size;
+  auto columns = [self nearestNeighborIndicesFrom:rect.x to:rect.br().x size:size.width
+                                       sourceSize:pyramid.image.cols];
+  auto rows = [self nearestNeighborIndicesFrom:rect.y to:rect.br().y size:size.height
+                                    sourceSize:pyramid.image.rows];
+
+  LITMattingRegionInputs inputs;
+  inputs.image.create(rect.size());
+  inputs.alpha.create(rect.size());
+  for (int i = 0; i < rect.height; i++) {
+    for (int j = 0; j < rect.width; j++) {
+      auto &pixel = pyramid.image(rows[i], columns[j]);
+      inputs.image(i, j) = cv::Vec3f(pixel(0), pixel(1), pixel(2)) / 255.0;
+      inputs.alpha(i, j) = pyramid.alpha(rows[i], columns[j]) / 255.0;
+    }
+  }
+  return inputs;
+}
+
+- (std::vector<int>)nearestNeighborIndicesFrom:(int)start to:(int)end size:(int)size
+                                    sourceSize:(int)sourceSize {
+  /// Matches the normalized coordinates nearest neighbor sampling of
+  /// \c LITMattingColorEstimationProcessor.
+  std::vector<int> indices;
+  indices.reserve(end - start);
+  for (int index = start; index < end; index++) {
+    auto position = ((float)index + 0.5f) / size;
+    indices.push_back(std::min((int)(position * sourceSize), sourceSize - 1));
+  }
+  return indices;
+}
+
+- (void)updateStepWithInputs:(const LITMattingRegionInputs &)inputs
+                  foreground:(const cv::Mat3b &)foreground
+                  background:(const cv::Mat3b &)background
+            outputForeground:(cv::Mat3b *)outputForeground
+            outputBackground:(cv::Mat3b *)outputBackground {
+  /// Performs the update step of \c LITMattingColorEstimationProcessor, where neighbors outside the
+  /// region are clamped to its edge.
+  static const int kNeighborX[4] = {-1, 1, 0, 0};
+  static const int kNeighborY[4] = {0, 0, -1, 1};
+  static const float kRegularization = 1e-05;
+
+  auto rows = inputs.alpha.rows;
+  auto cols = inputs.alpha.cols;
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      float a = inputs.alpha(i, j);
+      float a00 = a * a;
+      float a01 = a * (1 - a);
+      float a11 = (1 - a) * (1 - a);
+
+      auto &imageValue = inputs.image(i, j);
+      cv::Vec3f b0 = a * imageValue;
+      cv::Vec3f b1 = (1 - a) * imageValue;
+
+      for (int k = 0; k < 4; k++) {
+        auto neighborY = std::clamp(i + kNeighborY[k], 0, rows - 1);
+        auto neighborX = std::clamp(j + kNeighborX[k], 0, cols - 1);
+        float neighborAlpha = inputs.alpha(neighborY, neighborX);
+        auto neighborForeground = cv::Vec3f(foreground(neighborY, neighborX)) / 255.0;
+        auto neighborBackground = cv::Vec3f(background(neighborY, neighborX)) / 255.0;
+        float da = kRegularization + std::abs(a - neighborAlpha);
+        a00 += da;
+        a11 += da;
+        b0 += da * neighborForeground;
+        b1 += da * neighborBackground;
+      }
+
+      float det = a00 * a11 - a01 * a01;
+      cv::Vec3f f = (a11 * b0 - a01 * b1) * (1.0 / det);
+      cv::Vec3f b = (a00 * b1 - a01 * b0) * (1.0 / det);
+      (*outputForeground)(i, j) = f * 255.0;
+      (*outputBackground)(i, j) = b * 255.0;
+    }
+  }
+}
+
+- (void)writeForeground:(const cv::Mat3b &)foreground background:(const cv::Mat3b &)background
+                 inRect:(cv::Rect)rect outputForeground:(nullable cv::Mat4b *)outputForeground
+       outputBackground:(nullable cv::Mat4b *)outputBackground {
+  static const int kFromTo[] = {0, 0, 1, 1, 2, 2, 3, 3};
+  cv::Mat1b opaque(rect.size(), (uchar)255);
+  if (outputForeground) {
+    cv::Mat4b outputRegion = (*outputForeground)(rect);
+    cv::Mat sources[] = {foreground, opaque};
+    cv::mixChannels(sources, 2, &outputRegion, 1, kFromTo, 4);
+  }
+  if (outputBackground) {
+    cv::Mat4b outputRegion = (*outputBackground)(rect);
+    cv::Mat sources[] = {background, opaque};
+    cv::mixChannels(sources, 2, &outputRegion, 1, kFromTo, 4);
+  }
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,69 @@
+// Copyright (c) 2020 Lightricks. All rights reserved.
+// Created by Roni Shahino.
+
+#import "LITMattingColorEstimationTiledProcessor.h"
+
+#import "LITMattingColorEstimationTestUtils.h"
+
+SpecBegin(LITMattingColorEstimationTiledProcessor)
+
+__block cv::Mat4b image;
+__block cv::Mat1b alpha;
+
+beforeEach(^{
+  auto bundle = NSBundle.lt_testBundle;
+  image = LTLoadMatFromBundle(bundle, @"lemur.png");
+  alpha = LTLoadMatFromBundle(bundle, @"lemur_alpha.png");
+});
+
+it(@"should calculate background and foreground images", ^{
+  auto configuration = LITMattingColorEstimationProcessorConfigurationDefault();
+
+  auto processor = [[LITMattingColorEstimationTiledProcessor alloc] initWithTileSize:64];
+  cv::Mat4b foreground, background;
+  [processor estimateColorsOfImage:image alpha:alpha foreground:&foreground
+                        background:&background configuration:configuration];
+
+  auto bundle = NSBundle.lt_testBundle;
+  auto expectedForeground = LTLoadMatFromBundle(bundle, @"lemur_foreground_output.png");
+  auto expectedBackground = LTLoadMatFromBundle(bundle, @"lemur_background_output.png");
+
+  expect($(foreground)).to.beCloseToMatPSNR($(expectedForeground), 50);
+  expect($(background)).to.beCloseToMatPSNR($(expectedBackground), 50);
+});
+
+it(@"should calculate the same foreground and background regardless of the tile size", ^{
+  auto configuration = LITMattingColorEstimationProcessorConfigurationDefault();
+
+  auto untiledProcessor = [[LITMattingColorEstimationTiledProcessor alloc]
+                           initWithTileSize:std::max(image.cols, image.rows)];
+  cv::Mat4b foreground, background;
+  [untiledProcessor estimateColorsOfImage:image alpha:alpha foreground:&foreground
+                               background:&background configuration:configuration];
+
+  auto tiledProcessor = [[LITMattingColorEstimationTiledProcessor alloc] initWithTileSize:37];
+  cv::Mat4b tiledForeground, tiledBackground;
+  [tiledProcessor estimateColorsOfImage:image alpha:alpha foreground:&tiledForeground
+                             background:&tiledBackground configuration:configuration];
+
+  expect($(tiledForeground)).to.beCloseToMatWithin($(foreground), 0);
+  expect($(tiledBackground)).to.beCloseToMatWithin($(background), 0);
+});
+
+it(@"should restore original image by combining foreground and background", ^{
+  LITMattingColorEstimationProcessorConfiguration configuration;
+  configuration.numberOfIterationsForLargeScales = 2;
+  configuration.numberOfIterationsForSmallScales = 9;
+  configuration.smallScalesThreshold = 64;
+
+  auto processor = [[LITMattingColorEstimationTiledProcessor alloc] initWithTileSize:64];
+  cv::Mat4b foreground, background;
+  [processor estimateColorsOfImage:image alpha:alpha foreground:&foreground
+                        background:&background configuration:configuration];
+
+  auto restoredImage = LITCombineImagesByMask(foreground, background, alpha);
+
+  expect($(restoredImage)).to.beCloseToMatPSNR($(image), 50);
+});
+
+SpecEnd